@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = curvebench
+CONFIG   += console c++14
+CONFIG   -= app_bundle
+
+QT -= gui
+
+include(../lib/curvescore.pri)
+
+SOURCES += curvebench.cpp
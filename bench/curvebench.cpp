@@ -0,0 +1,431 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <string.h>
+
+#include "batchfitter.h"
+#include "beziereval.h"
+#include "bezierprojector.h"
+#include "cornerdetector.h"
+#include "curvefitter.h"
+#include "minimizer.h"
+#include "piecewisefitter.h"
+#include "strokeanalyzer.h"
+
+#define STROKE_COUNT    20000
+#define STROKE_LENGTH   64
+#define NOISE           0.5
+/* Samples per cubic piece of strokes with corners */
+#define PIECE_LENGTH    64
+/* Minimal measured time per benchmark case, in seconds */
+#define MIN_TIME        0.2
+/* Parameter accuracy of 1-D minimization cases */
+#define MINIMIZE_EPSILON 1e-6
+/* Largest distance of fit_lowest_order case, twice the noise */
+#define FIT_TOLERANCE   (2 * NOISE)
+
+static const int sizes[] = { 16, 64, 256, 1024, 4096, 16384, 100000 };
+
+static qreal random(qreal a, qreal b)
+{
+    return a + (b - a) * qrand() / RAND_MAX;
+}
+
+static void addNoise(PointArray<256> &points)
+{
+    for (int i = 0; i < 2 * points.count(); ++i)
+        points[i] += random(-NOISE, NOISE);
+}
+
+static PointArray<256> randomCurve()
+{
+    PointArray<256> curve;
+    for (int i = 0; i < SPLINE_ORDER; ++i)
+        curve << QPointF(random(0, 1000), random(0, 1000));
+    return curve;
+}
+
+/* Noisy samples of random cubic Bezier curve in 1000x1000 box */
+static PointArray<256> syntheticStroke(CurveFitter &fitter, int length)
+{
+    PointArray<256> points = fitter.curve(randomCurve(), length);
+    addNoise(points);
+    return points;
+}
+
+/* Noisy samples of chain of random cubic Bezier curves, which meet
+ * at corners, so that segmentation has something to find */
+static PointArray<256> cornerStroke(CurveFitter &fitter, int length)
+{
+    PointArray<256> points;
+    QPointF start(random(0, 1000), random(0, 1000));
+    while (points.count() < length) {
+        int pieceLength = qMin(PIECE_LENGTH, length - points.count());
+        PointArray<256> curve = randomCurve();
+        curve[0] = start.x();
+        curve[1] = start.y();
+        PointArray<256> piece = fitter.curve(curve, qMax(pieceLength, 2));
+        for (int i = 0; i < pieceLength; ++i)
+            points << piece.at(i);
+        start = curve.last();
+    }
+    addNoise(points);
+    return points;
+}
+
+class CurveBench
+{
+public:
+    CurveBench(QTextStream &out, bool json, qreal minTime) :
+        m_out(out), m_json(json), m_minTime(minTime), m_cases(0) {}
+
+    void run(int maxSize);
+    void runBatch(int strokeCount);
+
+private:
+    /* Repeats func for at least minTime seconds, reports time per call */
+    template <class Func>
+    void measure(const char *name, int size, Func func);
+
+    void begin();
+    void end();
+
+    QTextStream &m_out;
+    bool m_json;
+    qreal m_minTime;
+    int m_cases;
+};
+
+void CurveBench::begin()
+{
+    if (m_json)
+        m_out << "{\n  \"benchmarks\": [";
+    else
+        m_out << "benchmark,size,iterations,ns_per_call,ns_per_point\n";
+}
+
+void CurveBench::end()
+{
+    if (m_json)
+        m_out << "\n  ]\n}\n";
+    m_out.flush();
+}
+
+template <class Func>
+void CurveBench::measure(const char *name, int size, Func func)
+{
+    /* Warm up caches and lazily initialized dispatch */
+    func();
+
+    QElapsedTimer timer;
+    qint64 iterations = 0;
+    timer.start();
+    do {
+        func();
+        ++iterations;
+    } while (timer.nsecsElapsed() < m_minTime * 1e9);
+    qreal perCall = qreal(timer.nsecsElapsed()) / iterations;
+
+    if (m_json) {
+        m_out << (m_cases ? "," : "") << "\n    { \"name\": \"" << name
+              << "\", \"size\": " << size
+              << ", \"iterations\": " << iterations
+              << ", \"ns_per_call\": " << perCall
+              << ", \"ns_per_point\": " << perCall / size << " }";
+    } else {
+        m_out << name << "," << size << "," << iterations << ","
+              << perCall << "," << perCall / size << "\n";
+    }
+    m_out.flush();
+    ++m_cases;
+}
+
+void CurveBench::run(int maxSize)
+{
+    qsrand(1);
+    CurveFitter fitter;
+
+    begin();
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        int size = sizes[s];
+        if (size > maxSize)
+            break;
+
+        PointArray<256> stroke = syntheticStroke(fitter, size);
+        PointArray<256> corners = cornerStroke(fitter, size);
+        PointArray<256> curve;
+
+        measure("fit_euclidean", size, [&]() {
+            fitter.fit(stroke, curve, CurveFitter::EUCLIDEAN);
+        });
+        measure("fit_affine", size, [&]() {
+            fitter.fit(stroke, curve, CurveFitter::AFFINE);
+        });
+
+        PointArraySoA<256> strokeSoA(stroke);
+        measure("fit_affine_soa", size, [&]() {
+            fitter.fit(strokeSoA, curve, CurveFitter::AFFINE);
+        });
+
+        CurveFitter singleFitter;
+        singleFitter.setPrecision(CurveFitter::SINGLE);
+        measure("fit_affine_single", size, [&]() {
+            singleFitter.fit(stroke, curve, CurveFitter::AFFINE);
+        });
+
+        /* Same stroke at every order, each one has its own instance */
+        static const char *orderNames[] = { "fit_order_3", "fit_order_4",
+            "fit_order_5", "fit_order_6" };
+        CurveFitter orderFitter;
+        for (int order = MIN_FIT_ORDER; order <= MAX_FIT_ORDER; ++order) {
+            orderFitter.setOrder(order);
+            measure(orderNames[order - MIN_FIT_ORDER], size, [&]() {
+                orderFitter.fit(stroke, curve, CurveFitter::AFFINE,
+                    CurveFitter::LINEAR_LS);
+            });
+        }
+        orderFitter.setOrder(MAX_FIT_ORDER);
+        measure("fit_lowest_order", size, [&]() {
+            orderFitter.fitLowestOrder(stroke, curve, FIT_TOLERANCE,
+                CurveFitter::AFFINE, CurveFitter::LINEAR_LS);
+        });
+
+        fitter.fit(stroke, curve, CurveFitter::EUCLIDEAN);
+        measure("curve", size, [&]() {
+            PointArray<256> points = fitter.curve(curve, size);
+            Q_UNUSED(points);
+        });
+        measure("curve_soa", size, [&]() {
+            PointArraySoA<256> points;
+            fitter.curve(curve, size, points);
+        });
+
+        /* Same kernel width in bytes, twice as many float lanes */
+        QVarLengthArray<qreal, 256> evalTs(size), evalXy(2 * size);
+        QVarLengthArray<float, 256> evalTsF(size), evalXyF(2 * size);
+        float curveF[2 * SPLINE_ORDER];
+        for (int i = 0; i < size; ++i)
+            evalTsF[i] = evalTs[i] = (qreal) i / size;
+        for (int i = 0; i < 2 * SPLINE_ORDER; ++i)
+            curveF[i] = curve.data()[i];
+        measure("evaluate_double", size, [&]() {
+            BezierEvaluator::evaluate(SPLINE_ORDER, curve.data(), size,
+                evalTs.data(), evalXy.data());
+        });
+        measure("evaluate_float", size, [&]() {
+            BezierEvaluator::evaluate(SPLINE_ORDER, curveF, size,
+                evalTsF.data(), evalXyF.data());
+        });
+
+        /* Splitting does not depend on stroke size, so split at size
+         * distinct parameters to report comparable per point time */
+        measure("split_casteljau", size, [&]() {
+            PointArray<256> left, right;
+            for (int i = 0; i < size; ++i)
+                fitter.splitCasteljau(curve, (i + 0.5) / size, left, right);
+        });
+
+        QVarLengthArray<qreal, 256> initial(size), ts(size);
+        fitter.chordLengthParam(size, stroke.data(), initial.data(),
+            CurveFitter::CHORD_LENGTH);
+        measure("reparametrize_points", size, [&]() {
+            memcpy(ts.data(), initial.data(), size * sizeof(qreal));
+            fitter.reparametrizePoints<SPLINE_ORDER>(curve.data(), size,
+                stroke.data(), ts.data());
+        });
+        /* Closest points, independent of starting parameters */
+        measure("project_points", size, [&]() {
+            BezierProjector<qreal> projector(SPLINE_ORDER, curve.data());
+            projector.project(size, stroke.data(), ts.data());
+        });
+
+        /* Same by 1-D minimization of distance to each point, through a
+         * function pointer, an inlined lambda and all points in lockstep */
+        qreal cx[SPLINE_ORDER], cy[SPLINE_ORDER];
+        BezierEvaluator::powerBasis(SPLINE_ORDER, 1, curve.data(), cx, cy);
+        CurveFitter::SectionData section;
+        section.order = SPLINE_ORDER;
+        section.cx = cx;
+        section.cy = cy;
+        measure("minimize_fnptr", size, [&]() {
+            for (int i = 0; i < size; ++i) {
+                section.x = stroke.data() + 2 * i;
+                ts[i] = fitter.goldenSectionSearch(CurveFitter::func3, 0.0,
+                    1.0, MINIMIZE_EPSILON, &section);
+            }
+        });
+        measure("minimize_brent", size, [&]() {
+            for (int i = 0; i < size; ++i) {
+                const qreal *x = stroke.data() + 2 * i;
+                ts[i] = Minimizer::brent([&](qreal t) {
+                        qreal xy[2];
+                        BezierEvaluator::point(SPLINE_ORDER, cx, cy, t, xy);
+                        return (xy[0] - x[0]) * (xy[0] - x[0]) +
+                            (xy[1] - x[1]) * (xy[1] - x[1]);
+                    }, 0.0, 1.0, MINIMIZE_EPSILON);
+            }
+        });
+        QVarLengthArray<qreal, 256> zeros(size), ones(size), minXy(2 * size);
+        for (int i = 0; i < size; ++i) {
+            zeros[i] = 0.0;
+            ones[i] = 1.0;
+        }
+        measure("minimize_batch", size, [&]() {
+            Minimizer::brent([&](const qreal *u, qreal *fu) {
+                    BezierEvaluator::evaluate(SPLINE_ORDER, curve.data(),
+                        size, u, minXy.data());
+                    const qreal *x = stroke.constData();
+                    for (int i = 0; i < 2 * size; i += 2)
+                        fu[i / 2] = (minXy[i] - x[i]) * (minXy[i] - x[i]) +
+                            (minXy[i + 1] - x[i + 1]) *
+                            (minXy[i + 1] - x[i + 1]);
+                }, size, zeros.constData(), ones.constData(),
+                MINIMIZE_EPSILON, ts.data());
+        });
+
+        measure("direction", size, [&]() {
+            StrokeAnalyzer::direction(corners, true);
+        });
+        /* Chain of intermediate arrays breakpoints() used to build */
+        measure("breakpoints_chain", size, [&]() {
+            PointArray<256> points1 = StrokeAnalyzer::derivative(corners);
+            PointArray<256> points2 = StrokeAnalyzer::derivative(points1);
+            StrokeAnalyzer::detectOutliers(StrokeAnalyzer::length(points2),
+                OUTLIER_MULTIPLIER);
+        });
+        measure("breakpoints", size, [&]() {
+            StrokeAnalyzer::breakpoints(corners);
+        });
+        PointArraySoA<256> cornersSoA(corners);
+        measure("breakpoints_soa", size, [&]() {
+            StrokeAnalyzer::breakpoints(cornersSoA);
+        });
+        measure("to_soa", size, [&]() {
+            PointArraySoA<256> points(corners);
+        });
+        measure("corner_detector", size, [&]() {
+            CornerDetector detector;
+            for (int i = 0; i < corners.count(); ++i)
+                detector.addPoint(corners.at(i));
+        });
+        QVarLengthArray<int,128> breakpoints =
+            StrokeAnalyzer::breakpoints(corners);
+        measure("segments", size, [&]() {
+            StrokeAnalyzer::segments(corners, breakpoints);
+        });
+
+        /* Whole chain of cubics, as if segmentation missed every corner */
+        PiecewiseFitter piecewise;
+        measure("piecewise_fit", size, [&]() {
+            piecewise.fit(corners);
+        });
+    }
+    end();
+}
+
+void CurveBench::runBatch(int strokeCount)
+{
+    qsrand(1);
+    CurveFitter fitter;
+    QVector<PointArray<256> > strokes;
+    strokes.reserve(strokeCount);
+    for (int i = 0; i < strokeCount; ++i)
+        strokes << syntheticStroke(fitter, STROKE_LENGTH);
+
+    /* Powers of two up to ideal thread count, and ideal count itself */
+    QVector<int> threads;
+    int ideal = QThread::idealThreadCount();
+    for (int n = 1; n < ideal; n *= 2)
+        threads << n;
+    threads << ideal;
+
+    static const CurveFitter::Solver solvers[] = { CurveFitter::LINEAR_LS,
+        CurveFitter::NUMERIC_LM, CurveFitter::ANALYTIC_LM };
+    static const char *solverNames[] = { "linear_ls", "numeric_lm",
+        "analytic_lm" };
+
+    /* Size is the number of points in the batch, each call fits all of
+     * them on n threads */
+    begin();
+    for (unsigned s = 0; s < sizeof(solvers) / sizeof(solvers[0]); ++s) {
+        foreach (int n, threads) {
+            BatchFitter batch(n);
+            batch.setSolver(solvers[s]);
+            QByteArray name = QByteArray("batch_") + solverNames[s] + "_" +
+                QByteArray::number(n) + "_threads";
+            measure(name.constData(), strokeCount * STROKE_LENGTH, [&]() {
+                QVector<BatchFitter::Result> results = batch.fit(strokes);
+                Q_ASSERT(results.count() == strokes.count());
+            });
+        }
+    }
+    end();
+}
+
+static void usage(QTextStream &err)
+{
+    err << "Usage: curvebench [--json] [-n max_size] [-t min_seconds]\n"
+           "       curvebench [--json] [-t min_seconds] --batch [strokes]\n";
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    bool json = false;
+    bool batch = false;
+    int maxSize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    int strokeCount = STROKE_COUNT;
+    qreal minTime = MIN_TIME;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); ++i) {
+        const QString &arg = args.at(i);
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--batch") {
+            batch = true;
+            if (i + 1 < args.count() && !args.at(i + 1).startsWith("-"))
+                strokeCount = qMax(args.at(++i).toInt(), 1);
+        } else if (arg == "-n" && i + 1 < args.count()) {
+            maxSize = args.at(++i).toInt();
+        } else if (arg == "-t" && i + 1 < args.count()) {
+            minTime = args.at(++i).toDouble();
+        } else {
+            usage(err);
+            return arg == "-h" ? 0 : 1;
+        }
+    }
+
+    CurveBench bench(out, json, minTime);
+    if (batch)
+        bench.runBatch(strokeCount);
+    else
+        bench.run(maxSize);
+
+    return 0;
+}
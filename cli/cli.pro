@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = curvescli
+CONFIG   += console c++14
+CONFIG   -= app_bundle
+
+QT -= gui
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
+include(../lib/curvescore.pri)
+
+SOURCES += main.cpp
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "batchfitter.h"
+#include "curvefitter.h"
+#include "piecewisefitter.h"
+#include "strokeanalyzer.h"
+
+/* Same filtering as Pane applies to mouse moves */
+#define TOLERANCE   2.0
+/* Pause between samples, in ms, which starts new stroke */
+#define STROKE_GAP  250
+
+struct Stroke
+{
+    int log;
+    int index;
+    PointArray<256> points;
+};
+
+struct Segment
+{
+    int log;
+    int stroke;
+    int index;
+};
+
+static void usage(QTextStream &err)
+{
+    err << "Usage: curvescli [-o output.csv] [-g gap_ms] [-j threads] [-p] "
+           "log.csv...\n"
+           "Splits x,y,timestamp logs written by curves into strokes, "
+           "segments them\nand writes fitted Bezier control points as CSV.\n"
+           "With -p segments get as many cubic curves as they need, rows "
+           "then hold\n3 * k + 1 control points of k curves.\n";
+}
+
+/* Reads log of x,y,timestamp rows, stroke ends at pause longer than gap */
+static bool readLog(const QString &fileName, int log, qint64 gap,
+    QVector<Stroke> &strokes, qint64 &pointCount)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    Stroke stroke;
+    stroke.log = log;
+    stroke.index = 0;
+    qint64 lastTime = 0;
+    while (!file.atEnd()) {
+        QList<QByteArray> fields = file.readLine().trimmed().split(',');
+        if (fields.count() < 3)
+            continue;
+
+        QPointF point(fields.at(0).toDouble(), fields.at(1).toDouble());
+        qint64 time = fields.at(2).toLongLong();
+        ++pointCount;
+
+        if (stroke.points.count() > 0 && time - lastTime > gap) {
+            strokes << stroke;
+            stroke.index++;
+            stroke.points.clear();
+        }
+        lastTime = time;
+
+        if (stroke.points.count() > 0) {
+            /* Too close point breaks angle computation, so we skip them */
+            QPointF distance = stroke.points.last() - point;
+            if (distance.x() * distance.x() + distance.y() * distance.y() <
+                    TOLERANCE * TOLERANCE)
+                continue;
+        }
+        stroke.points << point;
+    }
+    if (stroke.points.count() > 0)
+        strokes << stroke;
+
+    return true;
+}
+
+/* Corners the GUI ends strokes on */
+static QVarLengthArray<int,128> strokeBreakpoints(const Stroke &stroke)
+{
+    return StrokeAnalyzer::breakpoints(stroke.points);
+}
+
+/* Composite spline of segment, error is the mean of its pieces */
+static BatchFitter::Result fitPiecewise(const StrokeView &segment)
+{
+    BatchFitter::Result result;
+    if (segment.count() < SPLINE_ORDER) {
+        result.status = BatchFitter::TOO_FEW_POINTS;
+        return result;
+    }
+
+    PiecewiseFitter fitter;
+    result.curve = fitter.fit(segment, 0, &result.stats);
+    result.error = result.stats.meanError();
+    if (!qIsFinite(result.error))
+        result.status = BatchFitter::INVALID_RESULT;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QString outputName;
+    qint64 gap = STROKE_GAP;
+    int threads = QThread::idealThreadCount();
+    bool piecewise = false;
+    QStringList logs;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); ++i) {
+        const QString &arg = args.at(i);
+        if ((arg == "-o" || arg == "-g" || arg == "-j") &&
+                i + 1 < args.count()) {
+            const QString &value = args.at(++i);
+            if (arg == "-o")
+                outputName = value;
+            else if (arg == "-g")
+                gap = value.toLongLong();
+            else
+                threads = qMax(value.toInt(), 1);
+        } else if (arg == "-p") {
+            piecewise = true;
+        } else if (arg.startsWith("-")) {
+            usage(err);
+            return arg == "-h" ? 0 : 1;
+        } else {
+            logs << arg;
+        }
+    }
+    if (logs.isEmpty()) {
+        usage(err);
+        return 1;
+    }
+    /* Segmentation and piecewise fits run on the global pool */
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Read strokes */
+    QVector<Stroke> strokes;
+    qint64 pointCount = 0;
+    for (int i = 0; i < logs.count(); ++i) {
+        if (!readLog(logs.at(i), i, gap, strokes, pointCount)) {
+            err << "Cannot open " << logs.at(i) << " for reading\n";
+            return 1;
+        }
+    }
+    qreal readTime = timer.nsecsElapsed() * 1e-9;
+
+    /* Segment strokes in parallel */
+    QVector<QVarLengthArray<int,128> > breakpoints =
+        QtConcurrent::blockingMapped<QVector<QVarLengthArray<int,128> > >(
+            strokes, strokeBreakpoints);
+
+    /* Segments are views into strokes, which stay unchanged from now on */
+    QVector<StrokeView> segments;
+    QVector<Segment> segmentIds;
+    for (int i = 0; i < strokes.count(); ++i) {
+        const QVector<StrokeView> parts = StrokeAnalyzer::segmentViews(
+            strokes.at(i).points, breakpoints.at(i));
+        for (int j = 0; j < parts.count(); ++j) {
+            Segment id = { strokes.at(i).log, strokes.at(i).index, j };
+            segments << parts.at(j);
+            segmentIds << id;
+        }
+    }
+    qreal segmentTime = timer.nsecsElapsed() * 1e-9 - readTime;
+
+    /* Fit segments on all cores */
+    QVector<BatchFitter::Result> results;
+    FitStats stats;
+    if (piecewise) {
+        results = QtConcurrent::blockingMapped<
+            QVector<BatchFitter::Result> >(segments, fitPiecewise);
+        foreach (const BatchFitter::Result &result, results)
+            stats += result.stats;
+    } else {
+        BatchFitter batch(threads);
+        results = batch.fit(segments, &stats);
+    }
+    qreal fitTime = timer.nsecsElapsed() * 1e-9 - readTime - segmentTime;
+
+    /* Write control points */
+    QFile output;
+    if (outputName.isEmpty()) {
+        output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        output.setFileName(outputName);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Text |
+                QIODevice::Truncate)) {
+            err << "Cannot open " << outputName << " for writing\n";
+            return 1;
+        }
+    }
+    QTextStream out(&output);
+    out << "log,stroke,segment,status,error";
+    for (int i = 0; i < SPLINE_ORDER; ++i)
+        out << ",x" << i << ",y" << i;
+    out << "\n";
+    for (int i = 0; i < results.count(); ++i) {
+        const Segment &id = segmentIds.at(i);
+        const BatchFitter::Result &result = results.at(i);
+        out << logs.at(id.log) << "," << id.stroke << "," << id.index << ","
+            << result.status << "," << result.error;
+        for (int j = 0; j < result.curve.count(); ++j)
+            out << "," << result.curve.at(j).x() << ","
+                << result.curve.at(j).y();
+        out << "\n";
+    }
+    out.flush();
+    qreal totalTime = timer.nsecsElapsed() * 1e-9;
+
+    err << "Read " << pointCount << " points, " << strokes.count()
+        << " strokes from " << logs.count() << " logs in " << readTime
+        << " s\n";
+    err << "Segmented into " << segments.count() << " segments in "
+        << segmentTime << " s\n";
+    err << "Fitted on " << threads << " threads in " << fitTime
+        << " s: " << pointCount / fitTime << " points/s, "
+        << strokes.count() / fitTime << " strokes/s\n";
+    err << "Fit " << stats.fits << " segments in " << stats.outerIterations
+        << " rounds, " << stats.iterations << " iterations, "
+        << stats.evaluations << " evaluations, " << stats.jacobians
+        << " Jacobians, mean error " << stats.meanError() << ", max error "
+        << stats.maxError << "\n";
+    err << "Solve " << stats.solveTime * 1e-9 << " s, reparametrization "
+        << stats.reparametrizationTime * 1e-9 << " s of CPU time\n";
+    err << "Total " << totalTime << " s: " << pointCount / totalTime
+        << " points/s, " << strokes.count() / totalTime << " strokes/s\n";
+
+    return 0;
+}
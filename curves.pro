@@ -1,2 +1,7 @@
 TEMPLATE = subdirs
-SUBDIRS = src tests
+SUBDIRS = lib src tests bench cli
+
+src.depends = lib
+tests.depends = lib
+bench.depends = lib
+cli.depends = lib
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QtCore/qnumeric.h>
+
+#include "batchfitter.h"
+
+/* Strokes handed out per request, per worker */
+#define CHUNKS_PER_WORKER 16
+
+class BatchFitter::Worker : public QRunnable
+{
+public:
+    Worker(const QVector<StrokeView> &strokes, BatchFitter::Result *results,
+        QAtomicInt &next, int chunk, CurveFitter::Transformation transformation,
+        CurveFitter::Solver solver, CurveFitter::Precision precision,
+        int order, const FitOptions &options)
+        : m_strokes(strokes), m_results(results), m_next(next),
+        m_chunk(chunk), m_transformation(transformation), m_solver(solver) {
+        m_fitter.setPrecision(precision);
+        m_fitter.setOrder(order);
+        m_fitter.setOptions(options);
+    }
+
+    void run();
+
+private:
+    const QVector<StrokeView> &m_strokes;
+    BatchFitter::Result *m_results;
+    QAtomicInt &m_next;
+    int m_chunk;
+    CurveFitter::Transformation m_transformation;
+    CurveFitter::Solver m_solver;
+
+    /* Per worker fitter */
+    CurveFitter m_fitter;
+};
+
+void BatchFitter::Worker::run()
+{
+    int count = m_strokes.count();
+    do {
+        int begin = m_next.fetchAndAddRelaxed(m_chunk);
+        if (begin >= count)
+            break;
+
+        int end = qMin(begin + m_chunk, count);
+        for (int i = begin; i < end; ++i) {
+            const StrokeView &stroke = m_strokes.at(i);
+            Result &result = m_results[i];
+            if (stroke.count() < m_fitter.order()) {
+                result.status = TOO_FEW_POINTS;
+                continue;
+            }
+
+            result.error = m_fitter.fit(stroke, result.curve,
+                m_transformation, m_solver, &result.stats);
+            if (!qIsFinite(result.error))
+                result.status = INVALID_RESULT;
+        }
+    } while (true);
+}
+
+BatchFitter::BatchFitter(int threads) :
+    m_transformation(CurveFitter::AFFINE),
+    m_solver(CurveFitter::LINEAR_LS),
+    m_precision(CurveFitter::DOUBLE),
+    m_order(SPLINE_ORDER)
+{
+    m_pool.setMaxThreadCount(qMax(threads, 1));
+}
+
+BatchFitter::~BatchFitter()
+{
+    m_pool.waitForDone();
+}
+
+void BatchFitter::setTransformation(CurveFitter::Transformation transformation)
+{
+    m_transformation = transformation;
+}
+
+void BatchFitter::setSolver(CurveFitter::Solver solver)
+{
+    m_solver = solver;
+}
+
+void BatchFitter::setPrecision(CurveFitter::Precision precision)
+{
+    m_precision = precision;
+}
+
+void BatchFitter::setOrder(int order)
+{
+    m_order = order;
+}
+
+void BatchFitter::setOptions(const FitOptions &options)
+{
+    m_options = options;
+}
+
+int BatchFitter::threadCount() const
+{
+    return m_pool.maxThreadCount();
+}
+
+QVector<BatchFitter::Result> BatchFitter::fit(
+    const QVector<PointArray<256> > &strokes, FitStats *total)
+{
+    QVector<StrokeView> views;
+    views.reserve(strokes.count());
+    for (int i = 0; i < strokes.count(); ++i)
+        views << strokes.at(i);
+    return fit(views, total);
+}
+
+QVector<BatchFitter::Result> BatchFitter::fit(
+    const QVector<StrokeView> &strokes, FitStats *total)
+{
+    /* Results are written in place by index, which keeps input order */
+    QVector<Result> results(strokes.count());
+    if (strokes.isEmpty())
+        return results;
+
+    int workers = qMin(threadCount(), strokes.count());
+    int chunk = qMax(1, strokes.count() / (workers * CHUNKS_PER_WORKER));
+    QAtomicInt next(0);
+
+    /* Workers write through raw data, QVector::operator[] would check
+     * for detach from every thread */
+    Result *data = results.data();
+    for (int i = 0; i < workers; ++i)
+        m_pool.start(new Worker(strokes, data, next, chunk,
+            m_transformation, m_solver, m_precision, m_order, m_options));
+    m_pool.waitForDone();
+
+    if (total) {
+        total->reset();
+        for (int i = 0; i < results.count(); ++i)
+            *total += results.at(i).stats;
+    }
+
+    return results;
+}
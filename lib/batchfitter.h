@@ -0,0 +1,80 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef BATCHFITTER_H
+#define BATCHFITTER_H
+
+#include <QThreadPool>
+#include <QVector>
+
+#include "curvefitter.h"
+#include "fitstats.h"
+#include "pointarray.h"
+#include "strokeview.h"
+
+/* Fits many strokes in parallel. Workers own their fitter and scratch
+ * space and pull chunks of strokes from a shared counter, so faster
+ * workers take over the rest of the batch. */
+class BatchFitter
+{
+public:
+    enum Status { SUCCESS, TOO_FEW_POINTS, INVALID_RESULT };
+
+    struct Result
+    {
+        Result() : error(0), status(SUCCESS) {}
+
+        PointArray<256> curve;
+        qreal error;
+        Status status;
+        FitStats stats;
+    };
+
+    explicit BatchFitter(int threads = QThread::idealThreadCount());
+    ~BatchFitter();
+
+    void setTransformation(CurveFitter::Transformation transformation);
+    void setSolver(CurveFitter::Solver solver);
+    void setPrecision(CurveFitter::Precision precision);
+    /* Order of fitted curves, strokes of fewer points are TOO_FEW_POINTS */
+    void setOrder(int order);
+    /* Time budget of options applies to each stroke */
+    void setOptions(const FitOptions &options);
+    int threadCount() const;
+
+    /* Blocks until all strokes are fitted, results are in input order.
+     * Stats of all fitted strokes are summed up into total, if given */
+    QVector<Result> fit(const QVector<PointArray<256> > &strokes,
+        FitStats *total = 0);
+    /* Same for views, points are read in place */
+    QVector<Result> fit(const QVector<StrokeView> &strokes,
+        FitStats *total = 0);
+
+private:
+    class Worker;
+
+    QThreadPool m_pool;
+    CurveFitter::Transformation m_transformation;
+    CurveFitter::Solver m_solver;
+    CurveFitter::Precision m_precision;
+    int m_order;
+    FitOptions m_options;
+};
+
+#endif // BATCHFITTER_H
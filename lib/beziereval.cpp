@@ -0,0 +1,415 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QVarLengthArray>
+#include <limits>
+
+#include "beziereval.h"
+
+#define SAMPLE_ANCHOR_STEP 32
+
+/* SIMD kernels work on doubles or floats and are built with per-function target
+ * attributes, so the rest of the code keeps the baseline instruction set */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(QT_COORD_TYPE)
+#define BEZIER_X86
+#include <immintrin.h>
+#endif
+
+bool BezierEvaluator::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case AUTO:
+    case SCALAR:
+        return true;
+#ifdef BEZIER_X86
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2") &&
+            __builtin_cpu_supports("fma");
+#endif
+    default:
+        return false;
+    }
+}
+
+BezierEvaluator::Kernel BezierEvaluator::bestKernel()
+{
+    /* Detected once, initialization of local statics is thread-safe */
+    static const Kernel best = isSupported(AVX2) ? AVX2 :
+        (isSupported(SSE2) ? SSE2 : SCALAR);
+    return best;
+}
+
+void BezierEvaluator::powerBasis(int splineOrder, const qreal *pxy,
+    qreal *cx, qreal *cy)
+{
+    /* c_j = C(n, j) * sum_i (-1)^(i + j) * C(j, i) * P_i, n = degree */
+    int n = splineOrder - 1;
+    qreal cnj = 1.0;
+    for (int j = 0; j <= n; ++j) {
+        qreal sx = 0, sy = 0;
+        qreal cji = 1.0;
+        for (int i = 0; i <= j; ++i) {
+            qreal sign = ((i + j) % 2) ? -1.0 : 1.0;
+            sx += sign * cji * pxy[2 * i];
+            sy += sign * cji * pxy[2 * i + 1];
+            cji = cji * (j - i) / (i + 1);
+        }
+        cx[j] = cnj * sx;
+        cy[j] = cnj * sy;
+        cnj = cnj * (n - j) / (j + 1);
+    }
+}
+
+void BezierEvaluator::powerBasis(int splineOrder, int count,
+    const qreal *pxy, qreal *cx, qreal *cy)
+{
+    for (int c = 0; c < count; ++c) {
+        powerBasis(splineOrder, pxy, cx, cy);
+        pxy += 2 * splineOrder;
+        cx += splineOrder;
+        cy += splineOrder;
+    }
+}
+
+void BezierEvaluator::powerBasis(int splineOrder, int count,
+    const float *pxy, float *cx, float *cy)
+{
+    QVarLengthArray<qreal, 16> dpxy(2 * splineOrder);
+    QVarLengthArray<qreal, 16> dcx(splineOrder), dcy(splineOrder);
+    for (int c = 0; c < count; ++c) {
+        for (int i = 0; i < 2 * splineOrder; ++i)
+            dpxy[i] = pxy[i];
+        powerBasis(splineOrder, dpxy.data(), dcx.data(), dcy.data());
+        for (int i = 0; i < splineOrder; ++i) {
+            cx[i] = dcx[i];
+            cy[i] = dcy[i];
+        }
+        pxy += 2 * splineOrder;
+        cx += splineOrder;
+        cy += splineOrder;
+    }
+}
+
+void BezierEvaluator::evaluate(int splineOrder, const qreal *pxy, int num,
+    const qreal *ts, qreal *xy, Kernel kernel)
+{
+    Q_ASSERT(splineOrder > 0);
+
+    QVarLengthArray<qreal, 16> cx(splineOrder), cy(splineOrder);
+    powerBasis(splineOrder, pxy, cx.data(), cy.data());
+    evaluateBasis(splineOrder, 1, cx.data(), cy.data(), num, ts, xy, kernel);
+}
+
+void BezierEvaluator::evaluate(int splineOrder, const float *pxy, int num,
+    const float *ts, float *xy, Kernel kernel)
+{
+    Q_ASSERT(splineOrder > 0);
+
+    QVarLengthArray<float, 16> cx(splineOrder), cy(splineOrder);
+    powerBasis(splineOrder, 1, pxy, cx.data(), cy.data());
+    evaluateBasis(splineOrder, 1, cx.data(), cy.data(), num, ts, xy, kernel);
+}
+
+void BezierEvaluator::evaluateBasis(int splineOrder, int count,
+    const qreal *cx, const qreal *cy, int num, const qreal *ts, qreal *xy,
+    Kernel kernel)
+{
+    Q_ASSERT(splineOrder > 0);
+
+    if (kernel == AUTO || !isSupported(kernel))
+        kernel = bestKernel();
+
+    for (int c = 0; c < count; ++c) {
+        const qreal *ccx = cx + c * splineOrder;
+        const qreal *ccy = cy + c * splineOrder;
+        qreal *cxy = xy + 2 * c * num;
+        switch (kernel) {
+        case AVX2:
+            evaluateAvx2(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        case SSE2:
+            evaluateSse2(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        default:
+            evaluateScalar(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        }
+    }
+}
+
+void BezierEvaluator::evaluateBasis(int splineOrder, int count,
+    const float *cx, const float *cy, int num, const float *ts, float *xy,
+    Kernel kernel)
+{
+    Q_ASSERT(splineOrder > 0);
+
+    if (kernel == AUTO || !isSupported(kernel))
+        kernel = bestKernel();
+
+    for (int c = 0; c < count; ++c) {
+        const float *ccx = cx + c * splineOrder;
+        const float *ccy = cy + c * splineOrder;
+        float *cxy = xy + 2 * c * num;
+        switch (kernel) {
+        case AVX2:
+            evaluateAvx2(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        case SSE2:
+            evaluateSse2(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        default:
+            evaluateScalar(splineOrder - 1, ccx, ccy, num, ts, cxy);
+            break;
+        }
+    }
+}
+
+void BezierEvaluator::sample(int splineOrder, const qreal *pxy, int num,
+    qreal *xy)
+{
+    sample(splineOrder, pxy, num, xy, xy + 1, 2);
+}
+
+void BezierEvaluator::sample(int splineOrder, const qreal *pxy, int num,
+    qreal *x, qreal *y)
+{
+    sample(splineOrder, pxy, num, x, y, 1);
+}
+
+void BezierEvaluator::sample(int splineOrder, const qreal *pxy, int num,
+    qreal *x, qreal *y, int stride)
+{
+    Q_ASSERT(splineOrder > 0);
+    if (num <= 0)
+        return;
+
+    int degree = splineOrder - 1;
+    QVarLengthArray<qreal, 16> cx(splineOrder), cy(splineOrder);
+    powerBasis(splineOrder, pxy, cx.data(), cy.data());
+
+    QVarLengthArray<qreal, 16> ts(splineOrder);
+    QVarLengthArray<qreal, 32> dxy(2 * splineOrder);
+    for (int s = 0; s < num; s += SAMPLE_ANCHOR_STEP) {
+        /* Exact values at degree + 1 consecutive samples */
+        for (int k = 0; k <= degree; ++k)
+            ts[k] = num > 1 ? (qreal) (s + k) / (num - 1) : 0.0;
+        evaluateScalar(degree, cx.data(), cy.data(), splineOrder, ts.data(),
+            dxy.data());
+
+        /* Turn them into forward differences, dxy[k] = delta^k f(t_s) */
+        for (int k = 1; k <= degree; ++k) {
+            for (int j = degree; j >= k; --j) {
+                dxy[2 * j] -= dxy[2 * (j - 1)];
+                dxy[2 * j + 1] -= dxy[2 * (j - 1) + 1];
+            }
+        }
+
+        int end = qMin(num, s + SAMPLE_ANCHOR_STEP);
+        for (int i = s; i < end; ++i) {
+            x[stride * i] = dxy[0];
+            y[stride * i] = dxy[1];
+            for (int k = 0; k < degree; ++k) {
+                dxy[2 * k] += dxy[2 * k + 2];
+                dxy[2 * k + 1] += dxy[2 * k + 3];
+            }
+        }
+    }
+
+    /* Exact end points */
+    x[0] = pxy[0];
+    y[0] = pxy[1];
+    if (num > 1) {
+        x[stride * (num - 1)] = pxy[2 * degree];
+        y[stride * (num - 1)] = pxy[2 * degree + 1];
+    }
+}
+
+qreal BezierEvaluator::sampleErrorBound(int splineOrder, const qreal *pxy)
+{
+    QVarLengthArray<qreal, 16> cx(splineOrder), cy(splineOrder);
+    powerBasis(splineOrder, pxy, cx.data(), cy.data());
+
+    qreal magnitude = 0;
+    for (int k = 0; k < splineOrder; ++k)
+        magnitude = qMax(magnitude, qMax(qAbs(cx[k]), qAbs(cy[k])));
+
+    /* Initial k-th difference carries up to 2^k rounding errors, which
+     * are amplified by C(m, k) after m steps between anchors */
+    qreal growth = 0, cmk = 1.0, pow2 = 1.0;
+    for (int k = 0; k < splineOrder; ++k) {
+        growth += cmk * pow2;
+        cmk = cmk * (SAMPLE_ANCHOR_STEP - k) / (k + 1);
+        pow2 *= 2;
+    }
+    return std::numeric_limits<qreal>::epsilon() * splineOrder * magnitude *
+        growth;
+}
+
+void BezierEvaluator::evaluateScalar(int degree, const qreal *cx,
+    const qreal *cy, int num, const qreal *ts, qreal *xy)
+{
+    /* Horner scheme on power basis */
+    for (int i = 0; i < num; ++i) {
+        qreal t = ts[i];
+        qreal x = cx[degree], y = cy[degree];
+        for (int k = degree - 1; k >= 0; --k) {
+            x = x * t + cx[k];
+            y = y * t + cy[k];
+        }
+        xy[2 * i] = x;
+        xy[2 * i + 1] = y;
+    }
+}
+
+void BezierEvaluator::evaluateScalar(int degree, const float *cx,
+    const float *cy, int num, const float *ts, float *xy)
+{
+    for (int i = 0; i < num; ++i) {
+        float t = ts[i];
+        float x = cx[degree], y = cy[degree];
+        for (int k = degree - 1; k >= 0; --k) {
+            x = x * t + cx[k];
+            y = y * t + cy[k];
+        }
+        xy[2 * i] = x;
+        xy[2 * i + 1] = y;
+    }
+}
+
+#ifdef BEZIER_X86
+
+__attribute__((target("sse2")))
+void BezierEvaluator::evaluateSse2(int degree, const qreal *cx,
+    const qreal *cy, int num, const qreal *ts, qreal *xy)
+{
+    int i = 0;
+    for (; i + 2 <= num; i += 2) {
+        __m128d t = _mm_loadu_pd(ts + i);
+        __m128d x = _mm_set1_pd(cx[degree]);
+        __m128d y = _mm_set1_pd(cy[degree]);
+        for (int k = degree - 1; k >= 0; --k) {
+            x = _mm_add_pd(_mm_mul_pd(x, t), _mm_set1_pd(cx[k]));
+            y = _mm_add_pd(_mm_mul_pd(y, t), _mm_set1_pd(cy[k]));
+        }
+        /* (x0, x1), (y0, y1) -> (x0, y0), (x1, y1) */
+        _mm_storeu_pd(xy + 2 * i, _mm_unpacklo_pd(x, y));
+        _mm_storeu_pd(xy + 2 * i + 2, _mm_unpackhi_pd(x, y));
+    }
+    evaluateScalar(degree, cx, cy, num - i, ts + i, xy + 2 * i);
+}
+
+__attribute__((target("avx2,fma")))
+void BezierEvaluator::evaluateAvx2(int degree, const qreal *cx,
+    const qreal *cy, int num, const qreal *ts, qreal *xy)
+{
+    int i = 0;
+    for (; i + 4 <= num; i += 4) {
+        __m256d t = _mm256_loadu_pd(ts + i);
+        __m256d x = _mm256_set1_pd(cx[degree]);
+        __m256d y = _mm256_set1_pd(cy[degree]);
+        for (int k = degree - 1; k >= 0; --k) {
+            x = _mm256_fmadd_pd(x, t, _mm256_set1_pd(cx[k]));
+            y = _mm256_fmadd_pd(y, t, _mm256_set1_pd(cy[k]));
+        }
+        /* (x0, x1, x2, x3), (y0, y1, y2, y3) ->
+         * (x0, y0, x2, y2), (x1, y1, x3, y3) ->
+         * (x0, y0, x1, y1), (x2, y2, x3, y3) */
+        __m256d lo = _mm256_unpacklo_pd(x, y);
+        __m256d hi = _mm256_unpackhi_pd(x, y);
+        _mm256_storeu_pd(xy + 2 * i, _mm256_permute2f128_pd(lo, hi, 0x20));
+        _mm256_storeu_pd(xy + 2 * i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+    }
+    evaluateSse2(degree, cx, cy, num - i, ts + i, xy + 2 * i);
+}
+
+__attribute__((target("sse2")))
+void BezierEvaluator::evaluateSse2(int degree, const float *cx,
+    const float *cy, int num, const float *ts, float *xy)
+{
+    int i = 0;
+    for (; i + 4 <= num; i += 4) {
+        __m128 t = _mm_loadu_ps(ts + i);
+        __m128 x = _mm_set1_ps(cx[degree]);
+        __m128 y = _mm_set1_ps(cy[degree]);
+        for (int k = degree - 1; k >= 0; --k) {
+            x = _mm_add_ps(_mm_mul_ps(x, t), _mm_set1_ps(cx[k]));
+            y = _mm_add_ps(_mm_mul_ps(y, t), _mm_set1_ps(cy[k]));
+        }
+        /* (x0, x1, x2, x3), (y0, y1, y2, y3) ->
+         * (x0, y0, x1, y1), (x2, y2, x3, y3) */
+        _mm_storeu_ps(xy + 2 * i, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(xy + 2 * i + 4, _mm_unpackhi_ps(x, y));
+    }
+    evaluateScalar(degree, cx, cy, num - i, ts + i, xy + 2 * i);
+}
+
+__attribute__((target("avx2,fma")))
+void BezierEvaluator::evaluateAvx2(int degree, const float *cx,
+    const float *cy, int num, const float *ts, float *xy)
+{
+    int i = 0;
+    for (; i + 8 <= num; i += 8) {
+        __m256 t = _mm256_loadu_ps(ts + i);
+        __m256 x = _mm256_set1_ps(cx[degree]);
+        __m256 y = _mm256_set1_ps(cy[degree]);
+        for (int k = degree - 1; k >= 0; --k) {
+            x = _mm256_fmadd_ps(x, t, _mm256_set1_ps(cx[k]));
+            y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(cy[k]));
+        }
+        /* Unpacking works within 128-bit lanes, giving
+         * (x0, y0, x1, y1, x4, y4, x5, y5), (x2, y2, x3, y3, x6, y6, x7, y7),
+         * which are then put in order by swapping the middle lanes */
+        __m256 lo = _mm256_unpacklo_ps(x, y);
+        __m256 hi = _mm256_unpackhi_ps(x, y);
+        _mm256_storeu_ps(xy + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(xy + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    evaluateSse2(degree, cx, cy, num - i, ts + i, xy + 2 * i);
+}
+
+#else
+
+void BezierEvaluator::evaluateSse2(int degree, const qreal *cx,
+    const qreal *cy, int num, const qreal *ts, qreal *xy)
+{
+    evaluateScalar(degree, cx, cy, num, ts, xy);
+}
+
+void BezierEvaluator::evaluateAvx2(int degree, const qreal *cx,
+    const qreal *cy, int num, const qreal *ts, qreal *xy)
+{
+    evaluateScalar(degree, cx, cy, num, ts, xy);
+}
+
+void BezierEvaluator::evaluateSse2(int degree, const float *cx,
+    const float *cy, int num, const float *ts, float *xy)
+{
+    evaluateScalar(degree, cx, cy, num, ts, xy);
+}
+
+void BezierEvaluator::evaluateAvx2(int degree, const float *cx,
+    const float *cy, int num, const float *ts, float *xy)
+{
+    evaluateScalar(degree, cx, cy, num, ts, xy);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef BEZIEREVAL_H
+#define BEZIEREVAL_H
+
+#include <QtGlobal>
+
+class BezierEvaluator
+{
+public:
+    /* AUTO picks the widest kernel supported by the running CPU */
+    enum Kernel { AUTO, SCALAR, SSE2, AVX2 };
+
+    static bool isSupported(Kernel kernel);
+    static Kernel bestKernel();
+
+    /* Evaluates Bezier curve pxy of given order at num parameters ts,
+     * xy receives num interleaved points */
+    static void evaluate(int splineOrder, const qreal *pxy, int num,
+        const qreal *ts, qreal *xy, Kernel kernel = AUTO);
+    /* Same in single precision, kernels process twice as many lanes.
+     * Power basis is computed in double and rounded once */
+    static void evaluate(int splineOrder, const float *pxy, int num,
+        const float *ts, float *xy, Kernel kernel = AUTO);
+
+    /* Power basis of count curves of given order, whose control points
+     * follow one another in pxy. cx and cy receive splineOrder
+     * coefficients per curve, lowest power first. Curves evaluated many
+     * times compute it once and pass it to evaluateBasis() */
+    static void powerBasis(int splineOrder, int count, const qreal *pxy,
+        qreal *cx, qreal *cy);
+    /* Same in single precision, computed in double and rounded once */
+    static void powerBasis(int splineOrder, int count, const float *pxy,
+        float *cx, float *cy);
+    /* Evaluates count curves of power basis cx, cy at num parameters ts,
+     * xy receives num interleaved points of each curve in turn */
+    static void evaluateBasis(int splineOrder, int count, const qreal *cx,
+        const qreal *cy, int num, const qreal *ts, qreal *xy,
+        Kernel kernel = AUTO);
+    static void evaluateBasis(int splineOrder, int count, const float *cx,
+        const float *cy, int num, const float *ts, float *xy,
+        Kernel kernel = AUTO);
+    /* Point at t of curve of power basis cx, cy, inlined for callers
+     * that get parameters one at a time, such as Newton steps */
+    template <typename T>
+    static inline void point(int splineOrder, const T *cx, const T *cy, T t,
+        T *xy) {
+        T x = cx[splineOrder - 1], y = cy[splineOrder - 1];
+        for (int k = splineOrder - 2; k >= 0; --k) {
+            x = x * t + cx[k];
+            y = y * t + cy[k];
+        }
+        xy[0] = x;
+        xy[1] = y;
+    }
+
+    /* Samples curve pxy at num uniform parameters from 0 to 1 by forward
+     * differencing, re-anchored on exact values every SAMPLE_ANCHOR_STEP
+     * samples. End points are copied exactly. */
+    static void sample(int splineOrder, const qreal *pxy, int num, qreal *xy);
+    /* Same, x and y receive num coordinates each */
+    static void sample(int splineOrder, const qreal *pxy, int num, qreal *x,
+        qreal *y);
+    /* Upper bound of deviation of sample() from exact evaluation */
+    static qreal sampleErrorBound(int splineOrder, const qreal *pxy);
+
+private:
+    /* Samples to x and y, stride apart, 2 for interleaved points */
+    static void sample(int splineOrder, const qreal *pxy, int num, qreal *x,
+        qreal *y, int stride);
+
+    static void powerBasis(int splineOrder, const qreal *pxy, qreal *cx,
+        qreal *cy);
+
+    static void evaluateScalar(int degree, const qreal *cx, const qreal *cy,
+        int num, const qreal *ts, qreal *xy);
+    static void evaluateSse2(int degree, const qreal *cx, const qreal *cy,
+        int num, const qreal *ts, qreal *xy);
+    static void evaluateAvx2(int degree, const qreal *cx, const qreal *cy,
+        int num, const qreal *ts, qreal *xy);
+
+    static void evaluateScalar(int degree, const float *cx, const float *cy,
+        int num, const float *ts, float *xy);
+    static void evaluateSse2(int degree, const float *cx, const float *cy,
+        int num, const float *ts, float *xy);
+    static void evaluateAvx2(int degree, const float *cx, const float *cy,
+        int num, const float *ts, float *xy);
+};
+
+#endif // BEZIEREVAL_H
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QtCore/qmath.h>
+#include <limits>
+
+#include "bezierprojector.h"
+
+/* Newton or bisection steps per root, bisections alone narrow bracket
+ * to 2^-MAX_ROOT_ITER of [0, 1] */
+#define MAX_ROOT_ITER 24
+/* Roots of derivatives only bound intervals searched for roots of next
+ * lower derivative, so a coarser step ends their refinement */
+#define BOUND_TOLERANCE 1e-3
+
+template <typename T>
+static inline T horner(const T *c, int degree, T t)
+{
+    T value = c[degree];
+    for (int i = degree - 1; i >= 0; --i)
+        value = value * t + c[i];
+    return value;
+}
+
+/* Value and derivative of c at t, both chains run side by side */
+template <typename T>
+static inline T horner(const T *c, int degree, T t, T *derivative)
+{
+    T value = c[degree];
+    T slope = 0;
+    for (int i = degree - 1; i >= 0; --i) {
+        slope = slope * t + value;
+        value = value * t + c[i];
+    }
+    *derivative = slope;
+    return value;
+}
+
+/* Root of c on [a, b], where c is monotonic and changes its sign.
+ * Newton steps from middle of bracket, which shrinks around them, until
+ * a step is below epsilon. Bisection replaces steps leaving bracket */
+template <typename T>
+static T solveBracket(const T *c, int degree, T a, T b, T fa, T epsilon)
+{
+    T t = (a + b) / 2;
+    for (int iter = 0; iter < MAX_ROOT_ITER; ++iter) {
+        T df;
+        T f = horner(c, degree, t, &df);
+        if (f == 0)
+            break;
+        if ((f < 0) == (fa < 0)) {
+            a = t;
+            fa = f;
+        } else {
+            b = t;
+        }
+        T next = df != 0 ? t - f / df : a;
+        if (qAbs(next - t) <= epsilon && next >= a && next <= b)
+            return next;
+        if (!(next > a && next < b))
+            next = (a + b) / 2;
+        t = next;
+    }
+    return t;
+}
+
+/* Root of linear d within (0, 1) goes to roots, returns their count */
+template <typename T>
+static int linearRoot(const T *d, T *roots)
+{
+    if (d[1] == 0)
+        return 0;
+    T t = -d[0] / d[1];
+    if (!(t > 0 && t < 1))
+        return 0;
+    roots[0] = t;
+    return 1;
+}
+
+/* Roots within (0, 1) of d[from], given in ascending order, split
+ * [0, 1] into intervals, where d[from - 1] is monotonic. Its roots are
+ * found there, and so on down to d[to]. When minima is set, only those
+ * roots of d[to] are looked for, where it changes sign from - to +.
+ * Returns count of roots of d[to], which replace ones in roots */
+template <typename T>
+static int isolate(const T (*d)[MAX_PROJECT_DEGREE + 1], int degree,
+    int from, int to, T *roots, int count, bool minima)
+{
+    /* Newton converges quadratically, so error after a step of
+     * sqrt(epsilon) is about machine epsilon */
+    const T epsilon = qSqrt(std::numeric_limits<T>::epsilon());
+    const T boundTolerance = BOUND_TOLERANCE;
+    T bounds[MAX_PROJECT_DEGREE + 2];
+    for (int j = from - 1; j >= to; --j) {
+        int numBounds = 0;
+        bounds[numBounds++] = 0;
+        for (int i = 0; i < count; ++i)
+            bounds[numBounds++] = roots[i];
+        bounds[numBounds++] = 1;
+
+        bool all = !minima || j > to;
+        int poly = degree - j;
+        count = 0;
+        T fa = horner(d[j], poly, bounds[0]);
+        for (int i = 0; i + 1 < numBounds; ++i) {
+            T a = bounds[i], b = bounds[i + 1];
+            T fb = horner(d[j], poly, b);
+            T t = -1;
+            if (fa == 0)
+                t = a;
+            else if (fb != 0 && (fa < 0) != (fb < 0) && (all || fa < 0))
+                t = solveBracket(d[j], poly, a, b, fa,
+                    j > to ? boundTolerance : epsilon);
+            if (t > 0 && t < 1 && (count == 0 || t > roots[count - 1]))
+                roots[count++] = t;
+            fa = fb;
+        }
+    }
+    return count;
+}
+
+template <typename T>
+BezierProjector<T>::BezierProjector(int splineOrder, const T *pxy) :
+    m_order(splineOrder), m_degree(2 * splineOrder - 3), m_fixedCount(0)
+{
+    Q_ASSERT(splineOrder >= 2 && splineOrder <= MAX_PROJECT_ORDER);
+
+    /* c_k = C(n, k) sum_i (-1)^(k - i) C(k, i) p_i, n = order - 1 */
+    int n = m_order - 1;
+    T binomN = 1;
+    for (int k = 0; k < m_order; ++k) {
+        T x = 0, y = 0, binomK = 1;
+        for (int i = 0; i <= k; ++i) {
+            T sign = ((k - i) % 2) ? -1 : 1;
+            x += sign * binomK * pxy[2 * i];
+            y += sign * binomK * pxy[2 * i + 1];
+            binomK = binomK * (k - i) / (i + 1);
+        }
+        m_cx[k] = binomN * x;
+        m_cy[k] = binomN * y;
+        binomN = binomN * (n - k) / (k + 1);
+    }
+
+    for (int k = 0; k < n; ++k) {
+        m_dx[k] = m_cx[k + 1] * (k + 1);
+        m_dy[k] = m_cy[k + 1] * (k + 1);
+    }
+
+    for (int m = 0; m <= m_degree; ++m)
+        m_d[0][m] = 0;
+    for (int i = 0; i < m_order; ++i) {
+        for (int k = 0; k < n; ++k)
+            m_d[0][i + k] += m_cx[i] * m_dx[k] + m_cy[i] * m_dy[k];
+    }
+    for (int j = 1; j < m_degree; ++j) {
+        for (int i = 0; i <= m_degree - j; ++i)
+            m_d[j][i] = m_d[j - 1][i + 1] * (i + 1);
+    }
+
+    if (n < m_degree) {
+        m_fixedCount = linearRoot(m_d[m_degree - 1], m_fixedRoots);
+        m_fixedCount = isolate<T>(m_d, m_degree, m_degree - 1, n, m_fixedRoots,
+            m_fixedCount, false);
+    }
+}
+
+template <typename T>
+T BezierProjector<T>::project(const T *xy, T *distance2) const
+{
+    int n = m_order - 1;
+    T d[MAX_PROJECT_DEGREE][MAX_PROJECT_DEGREE + 1];
+    T candidates[MAX_PROJECT_DEGREE + 2];
+    int count;
+
+    /* Derivatives below n-th depend on xy */
+    for (int i = 0; i <= m_degree; ++i)
+        d[0][i] = m_d[0][i];
+    for (int k = 0; k < n; ++k)
+        d[0][k] -= xy[0] * m_dx[k] + xy[1] * m_dy[k];
+    for (int j = 1; j < n; ++j) {
+        for (int i = 0; i <= m_degree - j; ++i)
+            d[j][i] = d[j - 1][i + 1] * (i + 1);
+    }
+    if (n < m_degree) {
+        for (int i = 0; i <= m_degree - n; ++i)
+            d[n][i] = m_d[n][i];
+        for (count = 0; count < m_fixedCount; ++count)
+            candidates[count] = m_fixedRoots[count];
+        count = isolate<T>(d, m_degree, n, 0, candidates, count, true);
+    } else {
+        count = linearRoot(d[0], candidates);
+    }
+    /* Minima of distance and ends of curve */
+    candidates[count++] = 0;
+    candidates[count++] = 1;
+
+    T bestT = 0, best = std::numeric_limits<T>::max();
+    for (int i = 0; i < count; ++i) {
+        T t = candidates[i];
+        T dx = horner(m_cx, n, t) - xy[0];
+        T dy = horner(m_cy, n, t) - xy[1];
+        T dist = dx * dx + dy * dy;
+        if (dist < best) {
+            best = dist;
+            bestT = t;
+        }
+    }
+    if (distance2)
+        *distance2 = best;
+    return bestT;
+}
+
+template <typename T>
+qreal BezierProjector<T>::project(int num, const T *xy, T *ts,
+    int *worst) const
+{
+    qreal maxDist = 0;
+    if (worst)
+        *worst = 0;
+    for (int i = 0; i < num; ++i) {
+        T dist;
+        ts[i] = project(xy + 2 * i, &dist);
+        if (dist > maxDist) {
+            maxDist = dist;
+            if (worst)
+                *worst = i;
+        }
+    }
+    return qSqrt(maxDist);
+}
+
+template class BezierProjector<qreal>;
+template class BezierProjector<float>;
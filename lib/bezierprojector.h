@@ -0,0 +1,66 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef BEZIERPROJECTOR_H
+#define BEZIERPROJECTOR_H
+
+#include <QtGlobal>
+
+#define MAX_PROJECT_ORDER 6
+/* Degree of (C(t) - p) . C'(t) */
+#define MAX_PROJECT_DEGREE (2 * MAX_PROJECT_ORDER - 3)
+
+/* Closest points on a Bezier curve of order 2 to MAX_PROJECT_ORDER.
+ * Distance from a point p has its extrema where q(t) = (C(t) - p) . C'(t)
+ * is zero. Roots of q in [0, 1] are isolated between roots of its
+ * derivatives, which split [0, 1] into intervals where it is monotonic,
+ * and refined there by bracketed Newton steps. Work per point is bounded
+ * by the degree, there are no starting guesses to go wrong. Instantiated
+ * for qreal and float. */
+template <typename T>
+class BezierProjector
+{
+public:
+    BezierProjector(int splineOrder, const T *pxy);
+
+    /* Parameter of point of curve closest to point xy, squared distance
+     * between them goes to distance2, if given */
+    T project(const T *xy, T *distance2 = 0) const;
+    /* Same for num interleaved points, ts receives their parameters.
+     * Returns largest distance, index of that point goes to worst, if
+     * given */
+    qreal project(int num, const T *xy, T *ts, int *worst = 0) const;
+
+private:
+    /* Curve in power basis and derivatives of q for p = 0. Point p
+     * changes only coefficients of t^0 .. t^(order - 2) of q, so
+     * derivatives from (order - 1)-th on and their roots are shared by
+     * all points */
+    int m_order;
+    int m_degree;
+    T m_cx[MAX_PROJECT_ORDER];
+    T m_cy[MAX_PROJECT_ORDER];
+    T m_dx[MAX_PROJECT_ORDER - 1]; /* C'(t) */
+    T m_dy[MAX_PROJECT_ORDER - 1];
+    T m_d[MAX_PROJECT_DEGREE][MAX_PROJECT_DEGREE + 1]; /* m_d[j] = q^(j) */
+    T m_fixedRoots[MAX_PROJECT_DEGREE]; /* Roots of m_d[order - 1] */
+    int m_fixedCount;
+};
+
+#endif // BEZIERPROJECTOR_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QtCore/qmath.h>
+
+#include "cornerdetector.h"
+
+CornerDetector::CornerDetector(qreal multiplier, int tinySegment) :
+    m_multiplier(multiplier),
+    m_tinySegment(tinySegment)
+{
+    reset();
+}
+
+void CornerDetector::reset()
+{
+    m_count = 0;
+    m_mean = 0;
+    m_m2 = 0;
+    m_candidate = -1;
+    m_pending = false;
+    m_breakpoints.clear();
+}
+
+int CornerDetector::addPoint(const QPointF &point)
+{
+    m_points[m_count % 4] = point;
+    ++m_count;
+    if (m_count < 4)
+        return -1;
+
+    /* Length of derivative of derivative of derivative */
+    const QPointF &p0 = m_points[m_count % 4];
+    const QPointF &p1 = m_points[(m_count + 1) % 4];
+    const QPointF &p2 = m_points[(m_count + 2) % 4];
+    const QPointF &p3 = m_points[(m_count + 3) % 4];
+    QPointF d = ((p3 - p2) - (p2 - p1)) - ((p2 - p1) - (p1 - p0));
+    qreal value = qSqrt(d.x() * d.x() + d.y() * d.y());
+    int i = m_count - 4;
+
+    /* Welford update, statistics include every value as whole stroke
+     * ones do */
+    qreal delta = value - m_mean;
+    m_mean += delta / (i + 1);
+    m_m2 += delta * (value - m_mean);
+
+    /* Outlier against values so far, first tinySegment values are too
+     * close to stroke start */
+    if (i >= m_tinySegment && i - m_candidate > m_tinySegment) {
+        qreal stddev = qSqrt(m_m2 / i);
+        if (qAbs(value - m_mean) > m_multiplier * stddev) {
+            m_candidate = i;
+            m_pending = true;
+        }
+    }
+
+    /* Outlier too close to stroke end is dropped, so it is a
+     * breakpoint only once tinySegment values follow it */
+    if (m_pending && i - m_candidate >= m_tinySegment) {
+        m_pending = false;
+        /* Compensate triple difference like breakpoints() does */
+        m_breakpoints << m_candidate + 2;
+        return m_candidate + 2;
+    }
+    return -1;
+}
+
+QVarLengthArray<int,128> CornerDetector::provisional() const
+{
+    QVarLengthArray<int,128> breakpoints;
+    breakpoints << -1;
+    breakpoints.append(m_breakpoints.constData(), m_breakpoints.count());
+    breakpoints << m_count - 2;
+    return breakpoints;
+}
+
+QVarLengthArray<int,128> CornerDetector::breakpoints(
+    const StrokeView &points) const
+{
+    Q_ASSERT(points.count() == m_count);
+    return StrokeAnalyzer::breakpoints(points, m_multiplier, m_tinySegment);
+}
+
+qreal CornerDetector::multiplier() const
+{
+    return m_multiplier;
+}
+
+int CornerDetector::tinySegment() const
+{
+    return m_tinySegment;
+}
+
+int CornerDetector::count() const
+{
+    return m_count;
+}
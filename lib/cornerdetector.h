@@ -0,0 +1,74 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef CORNERDETECTOR_H
+#define CORNERDETECTOR_H
+
+#include <QPointF>
+#include <QVarLengthArray>
+
+#include "strokeanalyzer.h"
+
+/* Streaming counterpart of StrokeAnalyzer::breakpoints, with the same
+ * statistic, multiplier and tinySegment rules. Each third difference
+ * length of points is compared against running mean and standard
+ * deviation (Welford) of all values so far, at O(1) time and memory per
+ * point, which gives provisional breakpoints while the stroke is drawn.
+ * Statistics of the whole stroke, which decide its breakpoints, are known
+ * only at its end, so provisional ones may be moved or dropped then. */
+class CornerDetector
+{
+public:
+    explicit CornerDetector(qreal multiplier = OUTLIER_MULTIPLIER,
+        int tinySegment = TINY_SEGMENT);
+
+    void reset();
+
+    /* Feeds next stroke point. Returns provisional breakpoint which this
+     * point confirmed, it is tinySegment points behind, or -1 */
+    int addPoint(const QPointF &point);
+
+    /* Provisional breakpoints of stroke so far, framed by -1 and the last
+     * point index minus one as breakpoints() */
+    QVarLengthArray<int,128> provisional() const;
+    /* Breakpoints of whole stroke, points are all points fed. Same as
+     * StrokeAnalyzer::breakpoints with multiplier and tinySegment */
+    QVarLengthArray<int,128> breakpoints(const StrokeView &points) const;
+
+    qreal multiplier() const;
+    int tinySegment() const;
+    int count() const;
+
+private:
+    qreal m_multiplier;
+    int m_tinySegment;
+
+    QPointF m_points[4]; /* Ring of last points */
+    int m_count;         /* Points seen */
+
+    /* Running statistics of third difference lengths */
+    qreal m_mean;
+    qreal m_m2;
+
+    int m_candidate;     /* Last outlier value index, -1 for none */
+    bool m_pending;      /* Candidate may still be dropped at stroke end */
+    QVarLengthArray<int,128> m_breakpoints;
+};
+
+#endif // CORNERDETECTOR_H
@@ -0,0 +1,946 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QtCore/qmath.h>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <levmar.h>
+
+#include "beziereval.h"
+#include "bezierprojector.h"
+#include "curvefitter.h"
+#include "minimizer.h"
+#include "tracer.h"
+#include "utils.h"
+
+#define MAX_KERNEL_ORDER 6
+/* Warm start stretches previous curve at most that much */
+#define MAX_EXTRAPOLATION 2.0
+/* Finite differences step of single precision solver, sqrt(FLT_EPSILON) */
+#define SINGLE_DIFF_DELTA 3.5e-4f
+/* Points reparametrized between checks of time budget */
+#define DEADLINE_STEP 64
+/* Points evaluated at once into stack buffer */
+#define EVALUATE_CHUNK 64
+
+static constexpr qreal binomial(int n, int k)
+{
+    return k == 0 ? 1.0 : binomial(n - 1, k - 1) * n / k;
+}
+
+/* Binomial coefficients C(Order - 1, i) of Bernstein polynomials */
+template <int Order>
+struct Binomials
+{
+    constexpr Binomials() : values() {
+        for (int i = 0; i < Order; ++i)
+            values[i] = binomial(Order - 1, i);
+    }
+    constexpr qreal operator[](int i) const { return values[i]; }
+
+    qreal values[Order];
+};
+
+/* Tables are constant-initialized at compile time, there is nothing
+ * to set up lazily and nothing to race on */
+template <int Order>
+static constexpr Binomials<Order> bins;
+
+CurveFitter::CurveFitter() :
+    m_precision(DOUBLE),
+    m_order(SPLINE_ORDER)
+{
+    Q_ASSERT(sizeof(qreal) == sizeof(double));
+}
+
+CurveFitter::~CurveFitter()
+{
+}
+
+void CurveFitter::setPrecision(Precision precision)
+{
+    m_precision = precision;
+}
+
+CurveFitter::Precision CurveFitter::precision() const
+{
+    return m_precision;
+}
+
+void CurveFitter::setOptions(const FitOptions &options)
+{
+    m_options = options;
+}
+
+const FitOptions &CurveFitter::options() const
+{
+    return m_options;
+}
+
+void CurveFitter::setOrder(int order)
+{
+    Q_ASSERT(order >= MIN_FIT_ORDER && order <= MAX_FIT_ORDER);
+    m_order = qBound(MIN_FIT_ORDER, order, MAX_FIT_ORDER);
+}
+
+int CurveFitter::order() const
+{
+    return m_order;
+}
+
+const FitWorkspace &CurveFitter::workspace() const
+{
+    return m_workspace;
+}
+
+template <int Order, typename T>
+void CurveFitter::point(const T *pxy, T t, T *xy)
+{
+    T tmp[2 * Order];
+    memcpy(tmp, pxy, sizeof(tmp));
+    for (int k = Order - 1; k > 0; --k) {
+        for (int i = 0; i < 2 * k; ++i)
+            tmp[i] = (1 - t) * tmp[i] + t * tmp[i + 2];
+    }
+    xy[0] = tmp[0];
+    xy[1] = tmp[1];
+}
+
+void CurveFitter::point(int splineOrder, const qreal *pxy, qreal t, qreal *xy)
+{
+    switch (splineOrder) {
+    case 1: point<1>(pxy, t, xy); return;
+    case 2: point<2>(pxy, t, xy); return;
+    case 3: point<3>(pxy, t, xy); return;
+    case 4: point<4>(pxy, t, xy); return;
+    case 5: point<5>(pxy, t, xy); return;
+    case 6: point<6>(pxy, t, xy); return;
+    default: break;
+    }
+    Q_ASSERT(splineOrder > MAX_KERNEL_ORDER);
+
+    QVarLengthArray<qreal, 4 * SPLINE_ORDER> tmp(2 * splineOrder);
+    memcpy(tmp.data(), pxy, sizeof(qreal) * 2 * splineOrder);
+    for (int k = splineOrder - 1; k > 0; --k) {
+        for (int i = 0; i < 2 * k; ++i)
+            tmp[i] = (1 - t) * tmp[i] + t * tmp[i + 2];
+    }
+    xy[0] = tmp[0];
+    xy[1] = tmp[1];
+}
+
+template <int Order, typename T>
+void CurveFitter::bernstein(T t, T *b)
+{
+    /* b[i] = bins[i] * t^i * (1 - t)^(Order - 1 - i) */
+    T tp = 1.0;
+    for (int i = 0; i < Order; ++i, tp *= t)
+        b[i] = T(bins<Order>[i]) * tp;
+    T sp = 1.0;
+    for (int i = Order - 1; i >= 0; --i, sp *= 1 - t)
+        b[i] *= sp;
+}
+
+void CurveFitter::point(const qreal *pxy, qreal t, qreal *xy)
+{
+    BezierEvaluator::evaluate(SPLINE_ORDER, pxy, 1, &t, xy);
+}
+
+void CurveFitter::splitCasteljau(const PointArray<256> &curve, qreal t,
+    PointArray<256> &left, PointArray<256> &right)
+{
+    left.resize(curve.count());
+    right.resize(curve.count());
+    splitCasteljau(curve.count(), curve.data(), t, left.data(), right.data());
+}
+
+template <int Order, typename T>
+void CurveFitter::splitCasteljau(const T *pxy, T t, T *pxy1, T *pxy2)
+{
+    T tmp[2 * Order];
+    memcpy(tmp, pxy, sizeof(tmp));
+    for (int k = 0; k < Order; ++k) {
+        pxy1[0 + 2 * k] = tmp[0];
+        pxy1[1 + 2 * k] = tmp[1];
+        pxy2[2 * (Order - k) - 2] = tmp[2 * (Order - k) - 2];
+        pxy2[2 * (Order - k) - 1] = tmp[2 * (Order - k) - 1];
+        for (int i = 0; i < 2 * (Order - k) - 2; ++i) {
+            tmp[i] = (1 - t) * tmp[i] + t * tmp[i + 2];
+        }
+    }
+}
+
+void CurveFitter::splitCasteljau(int splineOrder, const qreal *pxy,  qreal t,
+    qreal *pxy1, qreal *pxy2)
+{
+    switch (splineOrder) {
+    case 1: splitCasteljau<1>(pxy, t, pxy1, pxy2); return;
+    case 2: splitCasteljau<2>(pxy, t, pxy1, pxy2); return;
+    case 3: splitCasteljau<3>(pxy, t, pxy1, pxy2); return;
+    case 4: splitCasteljau<4>(pxy, t, pxy1, pxy2); return;
+    case 5: splitCasteljau<5>(pxy, t, pxy1, pxy2); return;
+    case 6: splitCasteljau<6>(pxy, t, pxy1, pxy2); return;
+    default: break;
+    }
+    Q_ASSERT(splineOrder > MAX_KERNEL_ORDER);
+
+    QVarLengthArray<qreal, 4 * SPLINE_ORDER> tmp(2 * splineOrder);
+    memcpy(tmp.data(), pxy, sizeof(qreal) * 2 * splineOrder);
+    for (int k = 0; k < splineOrder; ++k) {
+        pxy1[0 + 2 * k] = tmp[0];
+        pxy1[1 + 2 * k] = tmp[1];
+        pxy2[2 * (splineOrder - k) - 2] = tmp[2 * (splineOrder - k) - 2];
+        pxy2[2 * (splineOrder - k) - 1] = tmp[2 * (splineOrder - k) - 1];
+        for (int i = 0; i < 2 * (splineOrder - k) - 2; ++i) {
+            tmp[i] = (1 - t) * tmp[i] + t * tmp[i + 2];
+        }
+    }
+}
+
+PointArray<256> CurveFitter::curve(const PointArray<256> &curvePoints, int count)
+{
+    PointArray<256> points;
+    points.resize(count);
+
+    curve(curvePoints.count(), curvePoints.data(), count, points.data());
+
+    return points;
+}
+
+void CurveFitter::curve(const PointArray<256> &curvePoints, int count,
+    PointArraySoA<256> &points)
+{
+    points.resize(count);
+    BezierEvaluator::sample(curvePoints.count(), curvePoints.data(), count,
+        points.xData(), points.yData());
+}
+
+void CurveFitter::curve(const PointArray<256> &curvePoints, int count,
+    qreal *xy)
+{
+    curve(curvePoints.count(), curvePoints.data(), count, xy);
+}
+
+void CurveFitter::curve(int splineOrder, const qreal *pxy, int num, qreal *xy,
+    const qreal *ts)
+{
+    /* Explicit parameters are evaluated directly, uniform ones by
+     * forward differencing */
+    if (ts)
+        BezierEvaluator::evaluate(splineOrder, pxy, num, ts, xy);
+    else
+        BezierEvaluator::sample(splineOrder, pxy, num, xy);
+}
+
+template <int Order, typename T>
+void CurveFitter::updateBasis(InternalData<Order, T> *data)
+{
+    T *b = data->basis;
+    for (int i = 0; i < data->size; ++i, b += Order)
+        bernstein<Order>(data->ts[i], b);
+}
+
+template <int Order, typename T>
+void CurveFitter::func(T *p, T *hx, int m, int n, void *data)
+{
+    InternalData<Order, T> *iData = (InternalData<Order, T>*)data;
+    if (iData->pxy + 2 != p)
+        memcpy(iData->pxy + 2, p, sizeof(T) * m);
+
+    /* Curve points at ts are basis times control points */
+    const T *pxy = iData->pxy;
+    const T *b = iData->basis;
+    for (int i = 0; i < n / 2; ++i, b += Order, hx += 2) {
+        T x = 0, y = 0;
+        for (int k = 0; k < Order; ++k) {
+            x += b[k] * pxy[2 * k];
+            y += b[k] * pxy[2 * k + 1];
+        }
+        hx[0] = x;
+        hx[1] = y;
+    }
+}
+
+template <int Order, typename T>
+void CurveFitter::jacf(T *p, T *jac, int m, int n, void *data)
+{
+    Q_UNUSED(p);
+    InternalData<Order, T> *iData = (InternalData<Order, T>*)data;
+
+    /* Curve is linear in its control points, so derivative of point i
+     * by inner control point k is Bernstein polynomial k at ts[i] */
+    memset(jac, 0, sizeof(T) * m * n);
+    T *row = jac;
+    const T *b = iData->basis;
+    for (int i = 0; i < n / 2; ++i, row += 2 * m, b += Order) {
+        for (int k = 1; k < Order - 1; ++k) {
+            row[2 * (k - 1)] = b[k];
+            row[m + 2 * (k - 1) + 1] = b[k];
+        }
+    }
+}
+
+template <int Order, typename T>
+qreal CurveFitter::leastSquares(const T *x, int num,
+    InternalData<Order, T> *data)
+{
+    const int inner = Order - 2;
+    T *pxy = data->pxy;
+    const T *b;
+
+    /* Normal equations A * P = R for inner control points, end points
+     * are fixed, so their contribution is moved to the right side */
+    qreal a[inner][inner], r[inner][2];
+    memset(a, 0, sizeof(a));
+    memset(r, 0, sizeof(r));
+    b = data->basis;
+    for (int i = 0; i < num; ++i, b += Order) {
+        qreal rx = x[2 * i] - b[0] * pxy[0] -
+            b[Order - 1] * pxy[2 * Order - 2];
+        qreal ry = x[2 * i + 1] - b[0] * pxy[1] -
+            b[Order - 1] * pxy[2 * Order - 1];
+        for (int k = 0; k < inner; ++k) {
+            for (int l = k; l < inner; ++l)
+                a[k][l] += b[k + 1] * b[l + 1];
+            r[k][0] += b[k + 1] * rx;
+            r[k][1] += b[k + 1] * ry;
+        }
+    }
+    for (int k = 0; k < inner; ++k)
+        for (int l = 0; l < k; ++l)
+            a[k][l] = a[l][k];
+
+    /* Gaussian elimination with partial pivoting, both coordinates at once */
+    qreal scale = 0;
+    for (int k = 0; k < inner; ++k)
+        scale = qMax(scale, a[k][k]);
+    for (int k = 0; k < inner; ++k) {
+        int pivot = k;
+        for (int l = k + 1; l < inner; ++l)
+            if (qAbs(a[l][k]) > qAbs(a[pivot][k]))
+                pivot = l;
+        /* Singular system, e.g. too few distinct ts */
+        if (qAbs(a[pivot][k]) <= 1e-12 * scale)
+            return -1;
+        if (pivot != k) {
+            for (int l = 0; l < inner; ++l)
+                qSwap(a[k][l], a[pivot][l]);
+            qSwap(r[k][0], r[pivot][0]);
+            qSwap(r[k][1], r[pivot][1]);
+        }
+        for (int l = k + 1; l < inner; ++l) {
+            qreal f = a[l][k] / a[k][k];
+            for (int j = k; j < inner; ++j)
+                a[l][j] -= f * a[k][j];
+            r[l][0] -= f * r[k][0];
+            r[l][1] -= f * r[k][1];
+        }
+    }
+    for (int k = inner - 1; k >= 0; --k) {
+        for (int l = k + 1; l < inner; ++l) {
+            r[k][0] -= a[k][l] * pxy[2 * (l + 1)];
+            r[k][1] -= a[k][l] * pxy[2 * (l + 1) + 1];
+        }
+        pxy[2 * (k + 1)] = r[k][0] / a[k][k];
+        pxy[2 * (k + 1) + 1] = r[k][1] / a[k][k];
+    }
+
+    /* Squared error, same measure as levmar's ||e||_2 */
+    qreal err = 0;
+    b = data->basis;
+    for (int i = 0; i < num; ++i, b += Order) {
+        qreal dx = x[2 * i], dy = x[2 * i + 1];
+        for (int k = 0; k < Order; ++k) {
+            dx -= b[k] * pxy[2 * k];
+            dy -= b[k] * pxy[2 * k + 1];
+        }
+        err += dx * dx + dy * dy;
+    }
+    return err;
+}
+
+template <typename T>
+void CurveFitter::chordLengthParam(int len, const T *x, T *ts,
+    Parametrization parametrization)
+{
+    Q_ASSERT(x);
+    Q_ASSERT(ts);
+
+    /* Cumulative chord distances, summed up in qreal */
+    qreal length = 0.0;
+    ts[0] = 0.0;
+    for (int i = 1; i < len; ++i) {
+        qreal dx = x[2 * i] - x[2 * i - 2];
+        qreal dy = x[2 * i + 1] - x[2 * i - 1];
+        length += qPow((dx * dx + dy * dy),
+                       (parametrization == CENTRIPETAL ? .25 : .5));
+        ts[i] = length;
+    }
+
+    /* Normalized cumulative chord distances */
+    for (int i = 1; i < len; ++i)
+        ts[i] /= ts[len - 1];
+}
+
+qreal CurveFitter::func3(qreal t, void *data)
+{
+    SectionData *sData = (SectionData*)data;
+    qreal hx[2];
+
+    BezierEvaluator::point(sData->order, sData->cx, sData->cy, t, hx);
+    qreal dx = hx[0] - sData->x[0];
+    qreal dy = hx[1] - sData->x[1];
+
+    /* Compute squared error */
+    return dx * dx + dy * dy;
+}
+
+qreal CurveFitter::goldenSectionSearch(qreal (*func)(qreal x, void *data),
+    qreal a, qreal b, qreal epsilon, void *data)
+{
+    return Minimizer::brent([func, data](qreal x) { return func(x, data); },
+        a, b, epsilon);
+}
+
+template <int Order, typename T>
+T CurveFitter::reparametrize(const T *cx, const T *cy, const T *x, T t)
+{
+    /* Compute curve, curve' and curve'' points */
+    T hx[2], hx1[2], hx2[2];
+    BezierEvaluator::point(Order, cx, cy, t, hx);
+    BezierEvaluator::point(Order - 1, cx + Order, cy + Order, t, hx1);
+    BezierEvaluator::point(Order - 2, cx + 2 * Order, cy + 2 * Order, t, hx2);
+
+    /* Compute f'(t) and f"(t) */
+    T f1 = (hx[0] - x[0]) * hx1[0] + (hx[1] - x[1]) * hx1[1];
+    T f2 = hx1[0] * hx1[0] + hx1[1] * hx1[1] +
+        (hx[0] - x[0]) * hx2[0] + (hx[1] - x[1]) * hx2[1];
+
+    /* Newton method for optimization: t = t - f'(t)/f"(t) */
+    T newT = t - f1 / f2;
+    return newT;
+}
+
+template <int Order, typename T>
+bool CurveFitter::reparametrizePoints(const T *pxy, int num, const T *x, T *ts,
+    const QElapsedTimer *clock, qint64 deadline)
+{
+    BezierProjector<T> projector(Order, pxy);
+
+    /* End points are interpolated, their parameters stay 0 and 1 */
+    if (m_options.exactProjection) {
+        for (int j = 1; j < num - 1; j += DEADLINE_STEP) {
+            if (deadline > 0 && j > 1 && clock->nsecsElapsed() > deadline)
+                return false;
+            projector.project(qMin(DEADLINE_STEP, num - 1 - j), x + 2 * j,
+                ts + j);
+        }
+        return true;
+    }
+
+    /* Power basis of Bezier curve, its first and second derivatives,
+     * computed once for all Newton steps, Order coefficients apart.
+     * Derivatives are of lower degree, their top coefficients are zero */
+    T cx[3 * Order], cy[3 * Order];
+    BezierEvaluator::powerBasis(Order, 1, pxy, cx, cy);
+    for (int d = 1; d < 3; ++d) {
+        T *dx = cx + d * Order, *dy = cy + d * Order;
+        for (int k = 0; k < Order - 1; ++k) {
+            dx[k] = (k + 1) * dx[k - Order + 1];
+            dy[k] = (k + 1) * dy[k - Order + 1];
+        }
+        dx[Order - 1] = 0;
+        dy[Order - 1] = 0;
+    }
+
+    const T tolerance = m_options.newtonTolerance;
+    const int maxIter = m_options.maxNewtonIterations;
+    T diff = 0;
+    for (int j = 1; j < num - 1; ++j) {
+        if (deadline > 0 && j % DEADLINE_STEP == 0 &&
+                clock->nsecsElapsed() > deadline)
+            return false;
+        ts[j] += diff;
+        /* Saving old value */
+        diff = ts[j];
+        T backupT;
+        int iter = 0;
+        bool converged;
+        do {
+            backupT = ts[j];
+            ts[j] = reparametrize<Order>(cx, cy, x + 2 * j, ts[j]);
+            /* Quit, when improvement is less than tolerance or when
+             * Newton method oscillates instead of converging */
+            converged = qAbs(ts[j] - backupT) <= tolerance * qAbs(backupT);
+        } while (!converged && ++iter < maxIter);
+        /* Closest point, where Newton steps did not settle in [0, 1] */
+        if (!converged || !(ts[j] >= 0 && ts[j] <= 1))
+            ts[j] = projector.project(x + 2 * j);
+        /* Change between new and old */
+        diff = ts[j] - diff;
+    }
+    return true;
+}
+
+template <int Order, typename T>
+bool CurveFitter::warmStart(int len, const T *x, int known,
+    const qreal *prevTs, const T *prevPxy, T *ts, T *pxy)
+{
+    /* ts holds chord length parametrization of x. Previous curve at
+     * prevTs[known - 1] and new one at ts[known - 1] pass the same point,
+     * so parameters of previous curve are stretched by ratio of them */
+    qreal ratio = prevTs[known - 1] / ts[known - 1];
+    if (!(ratio > 0 && ratio <= MAX_EXTRAPOLATION))
+        return false;
+
+    /* Newton steps may leave some parameters out of order or out of
+     * [0, 1], keep them monotonic so that errors do not carry over */
+    ts[0] = 0.0;
+    for (int i = 1; i < known; ++i)
+        ts[i] = qBound(ts[i - 1], T(prevTs[i] / ratio), T(1.0));
+
+    /* Left part of split at ratio is previous curve over [0, ratio],
+     * extrapolated past its end when points were appended */
+    T right[2 * Order];
+    splitCasteljau<Order>(prevPxy, T(ratio), pxy, right);
+
+    /* End points are interpolated */
+    pxy[0] = x[0];
+    pxy[1] = x[1];
+    pxy[2 * Order - 2] = x[2 * len - 2];
+    pxy[2 * Order - 1] = x[2 * len - 1];
+
+    return true;
+}
+
+qreal CurveFitter::fit(const StrokeView &points, PointArray<256> &curve,
+    Transformation transformation, Solver solver, FitStats *stats)
+{
+    return fit(m_order, points.xData(), points.yData(), points.stride(),
+        points.count(), curve, 0, 0, transformation, solver, stats);
+}
+
+qreal CurveFitter::refit(const StrokeView &points, PointArray<256> &curve,
+    QVarLengthArray<qreal,256> &ts, Transformation transformation,
+    Solver solver, FitStats *stats)
+{
+    /* Leading points, which previous fit knows parameters of */
+    int known = qMin(ts.count(), points.count());
+    ts.resize(points.count());
+    return fit(m_order, points.xData(), points.yData(), points.stride(),
+        points.count(), curve, ts.data(), known, transformation, solver, stats);
+}
+
+qreal CurveFitter::fitLowestOrder(const StrokeView &points,
+    PointArray<256> &curve, qreal tolerance, Transformation transformation,
+    Solver solver, FitStats *stats)
+{
+    Q_ASSERT(points.count() >= MIN_FIT_ORDER);
+    QVarLengthArray<qreal, 256> ts(points.count());
+    int maxOrder = qMin(m_order, points.count());
+
+    /* Lower orders are cheaper to fit, evaluate and render, so the first
+     * order within tolerance wins */
+    qreal distance = 0;
+    for (int order = MIN_FIT_ORDER; order <= maxOrder; ++order) {
+        fit(order, points.xData(), points.yData(), points.stride(),
+            points.count(), curve, 0, 0, transformation, solver, stats);
+        distance = project(curve, points, ts.data());
+        if (distance <= tolerance)
+            break;
+    }
+    return distance;
+}
+
+qreal CurveFitter::project(const PointArray<256> &curve,
+    const StrokeView &points, qreal *ts, int *worst)
+{
+    Q_ASSERT(curve.count() <= MAX_PROJECT_ORDER);
+    int num = points.count();
+    if (worst)
+        *worst = 0;
+    if (num == 0)
+        return 0;
+
+    /* Projection works on interleaved points */
+    const qreal *x = points.xData();
+    if (points.stride() != 2 || points.yData() != x + 1) {
+        m_workspace.reset(FitWorkspace::size<qreal>(2 * num));
+        qreal *copy = m_workspace.allocate<qreal>(2 * num);
+        for (int i = 0; i < num; ++i) {
+            copy[2 * i] = points.x(i);
+            copy[2 * i + 1] = points.y(i);
+        }
+        x = copy;
+    }
+    BezierProjector<qreal> projector(curve.count(), curve.constData());
+    return projector.project(num, x, ts, worst);
+}
+
+qreal CurveFitter::fit(int order, const qreal *px, const qreal *py,
+    int stride, int num, PointArray<256> &curve, qreal *ts, int known,
+    Transformation transformation, Solver solver, FitStats *stats)
+{
+    typedef qreal (CurveFitter::*Fit)(const qreal *px, const qreal *py,
+        int stride, int num, PointArray<256> &curve, qreal *ts, int known,
+        Transformation transformation, Solver solver, FitStats *stats);
+    /* Every order and precision gets its own instance with fixed size
+     * loops and stack arrays, indexed by order and Precision */
+    static const Fit fits[MAX_FIT_ORDER - MIN_FIT_ORDER + 1][2] = {
+        { &CurveFitter::fit<3, qreal>, &CurveFitter::fit<3, float> },
+        { &CurveFitter::fit<4, qreal>, &CurveFitter::fit<4, float> },
+        { &CurveFitter::fit<5, qreal>, &CurveFitter::fit<5, float> },
+        { &CurveFitter::fit<6, qreal>, &CurveFitter::fit<6, float> },
+    };
+    Q_ASSERT(order >= MIN_FIT_ORDER && order <= MAX_FIT_ORDER);
+    return (this->*fits[order - MIN_FIT_ORDER][m_precision])(px, py, stride,
+        num, curve, ts, known, transformation, solver, stats);
+}
+
+/* Interleaved input is solved for in place, when precision matches */
+static inline qreal *inPlace(const qreal *xy, qreal *)
+{
+    return const_cast<qreal*>(xy);
+}
+
+static inline float *inPlace(const qreal *, float *)
+{
+    return 0;
+}
+
+/* Elements of work array levmar needs with and without jacf */
+static inline int levmarWorkSize(int m, int n)
+{
+    return qMax(LM_DER_WORKSZ(m, n), LM_DIF_WORKSZ(m, n));
+}
+
+#ifdef CURVES_LEVMAR_REENTRANT
+#ifdef LINSOLVERS_RETAIN_MEMORY
+#error "levmar retains linear solver memory in statics, it is not reentrant"
+#endif
+#else
+/* levmar built with LINSOLVERS_RETAIN_MEMORY, its default, keeps buffers
+ * of its linear solvers in statics, so solves are serialized */
+static QMutex *levmarMutex()
+{
+    static QMutex mutex;
+    return &mutex;
+}
+#endif
+
+/* levmar in precision of its arguments, finite differences without jacf.
+ * work holds levmarWorkSize() elements, so levmar allocates none */
+static inline void levmar(void (*func)(double*, double*, int, int, void*),
+    void (*jacf)(double*, double*, int, int, void*), double *p, double *x,
+    int m, int n, int itmax, double *info, double *work, void *data)
+{
+#ifndef CURVES_LEVMAR_REENTRANT
+    QMutexLocker locker(levmarMutex());
+#endif
+    if (jacf)
+        dlevmar_der(func, jacf, p, x, m, n, itmax, NULL, info, work, NULL,
+            data);
+    else
+        dlevmar_dif(func, p, x, m, n, itmax, NULL, info, work, NULL, data);
+}
+
+static inline void levmar(void (*func)(float*, float*, int, int, void*),
+    void (*jacf)(float*, float*, int, int, void*), float *p, float *x,
+    int m, int n, int itmax, float *info, float *work, void *data)
+{
+#ifndef CURVES_LEVMAR_REENTRANT
+    QMutexLocker locker(levmarMutex());
+#endif
+    if (jacf)
+        slevmar_der(func, jacf, p, x, m, n, itmax, NULL, info, work, NULL,
+            data);
+    else {
+        /* Default step of 1e-6 is below float resolution of coordinates */
+        float opts[LM_OPTS_SZ] = { LM_INIT_MU, LM_STOP_THRESH, LM_STOP_THRESH,
+            LM_STOP_THRESH, SINGLE_DIFF_DELTA };
+        slevmar_dif(func, p, x, m, n, itmax, opts, info, work, NULL, data);
+    }
+}
+
+template <int Order, typename T>
+qreal CurveFitter::fit(const qreal *px, const qreal *py, int stride, int num,
+    PointArray<256> &curve, qreal *ts, int known,
+    Transformation transformation, Solver solver, FitStats *stats)
+{
+    TRACE_SCOPE("fit");
+    QElapsedTimer clock;
+    clock.start();
+
+    /* Init input data, solver works on interleaved points */
+    int sz = 2 * num;
+    bool interleaved = (stride == 2 && py == px + 1);
+
+    T *x = 0;
+    if (transformation != AFFINE && interleaved)
+        x = inPlace(px, x);
+    bool owned = !x;
+
+    /* Scratch memory of the whole fit is reserved at once */
+    int m = 2 * Order - 2 * 2;
+    int n = sz;
+    int workSize = levmarWorkSize(m, n);
+    m_workspace.reset((owned ? FitWorkspace::size<T>(sz) : 0) +
+        FitWorkspace::size<T>(num) +
+        FitWorkspace::size<T>(num * Order) +
+        FitWorkspace::size<T>(workSize));
+    if (owned)
+        x = m_workspace.allocate<T>(sz);
+    T *work = m_workspace.allocate<T>(workSize);
+
+    qreal mean[2] = {.0, .0};
+    qreal std[2] = {.0, .0};
+    if (transformation == AFFINE) {
+        for (int i = 0; i < num; ++i) {
+            mean[0] += px[i * stride];
+            mean[1] += py[i * stride];
+        }
+        mean[0] /= num;
+        mean[1] /= num;
+
+        for (int i = 0; i < num; ++i) {
+            std[0] += (px[i * stride] - mean[0]) * (px[i * stride] - mean[0]);
+            std[1] += (py[i * stride] - mean[1]) * (py[i * stride] - mean[1]);
+        }
+        std[0] = qSqrt(std[0] / num);
+        std[1] = qSqrt(std[1] / num);
+
+        qreal minStd = qMin(std[0], std[1]);
+        std[0] /= minStd;
+        std[1] /= minStd;
+
+        for (int i = 0; i < num; ++i) {
+            x[2 * i] = (px[i * stride] - mean[0]) / std[0];
+            x[2 * i + 1] = (py[i * stride] - mean[1]) / std[1];
+        }
+    } else if (owned) {
+        for (int i = 0; i < num; ++i) {
+            x[2 * i] = px[i * stride];
+            x[2 * i + 1] = py[i * stride];
+        }
+    }
+
+    InternalData<Order, T> data(m_workspace, num);
+    /* Previous curve in coordinates of x */
+    T prevPxy[2 * Order];
+    bool warm = ts && known > 1 && curve.count() == Order;
+    if (warm) {
+        for (int i = 0; i < 2 * Order; i += 2) {
+            prevPxy[i] = curve[i];
+            prevPxy[i + 1] = curve[i + 1];
+            if (transformation == AFFINE) {
+                prevPxy[i] = (curve[i] - mean[0]) / std[0];
+                prevPxy[i + 1] = (curve[i + 1] - mean[1]) / std[1];
+            }
+        }
+    }
+
+    T pxy[2 * Order];
+    data.pxy = pxy;
+    chordLengthParam(sz / 2, x, data.ts, CHORD_LENGTH);
+
+    qreal segmentLen = (sz / (Order - 1));
+    /* Init middle points of Bezier curve */
+    for (int i = 2; i < 2 * Order - 2; i += 2) {
+        int idx = (i / 2) * segmentLen;
+        idx -= idx % 2;
+        data.pxy[i] = x[idx];
+        data.pxy[i + 1] = x[idx + 1];
+    }
+
+    /* Init first point of Bezier curve */
+    data.pxy[0] = x[0];
+    data.pxy[1] = x[1];
+
+    /* Init last point of Bezier curve */
+    data.pxy[2 * Order - 2] = x[sz - 2];
+    data.pxy[2 * Order - 1] = x[sz - 1];
+
+    if (Order > 3) {
+        int idx = (segmentLen - (int)segmentLen % 2);
+        data.pxy[2] = (x[idx] - x[0]) * 2 + x[0];
+        data.pxy[3] = (x[idx + 1] - x[1]) * 2 + x[1];
+
+        data.pxy[2 * Order - 4] = (x[sz - 2 - idx] - x[sz - 2]) * 2 +
+            x[sz - 2];
+        data.pxy[2 * Order - 3] = (x[sz - 1 - idx] - x[sz - 1]) * 2 +
+            x[sz - 1];
+    } else {
+        /* Quadratic passes middle point at t = 0.5, where it is
+         * (P0 + 2 * P1 + P2) / 4 */
+        data.pxy[2] = 2 * data.pxy[2] - (data.pxy[0] + data.pxy[4]) / 2;
+        data.pxy[3] = 2 * data.pxy[3] - (data.pxy[1] + data.pxy[5]) / 2;
+    }
+
+    /* Start from previous fit instead, when it is close enough */
+    if (warm)
+        warmStart<Order>(sz / 2, x, known, ts, prevPxy, data.ts, data.pxy);
+    updateBasis(&data);
+
+    /* info[0]= ||e||_2 at initial p.
+     * info[1-4]=[ ||e||_2, ||J^T e||_inf,  ||Dp||_2, \mu/max[J^T J]_ii ], all computed at estimated p.
+     * info[5]= # iterations,
+     * info[6]=reason for terminating: 1 - stopped by small gradient J^T e
+     *                                 2 - stopped by small Dp
+     *                                 3 - stopped by itmax
+     *                                 4 - singular matrix. Restart from current p with increased \mu
+     *                                 5 - no further error reduction is possible. Restart with increased mu
+     *                                 6 - stopped by small ||e||_2
+     *                                 7 - stopped by invalid (i.e. NaN or Inf) "func" values; a user error
+     * info[7]= # function evaluations
+     * info[8]= # Jacobian evaluations
+     * info[9]= # linear systems solved, i.e. # attempts for reducing error
+     */
+    T info[LM_INFO_SZ];
+    T *p = data.pxy + 2;
+    qreal fnorm = INT_MAX, fnormPrev;
+    /* Rounds may make error worse, best curve is returned then */
+    T bestPxy[2 * Order];
+    qreal bestFnorm = INT_MAX;
+    qint64 roundStart = 0;
+
+    FitStats fitStats;
+    QElapsedTimer timer;
+    do {
+        /* Optimize spline shape */
+        timer.start();
+        qreal err = -1;
+        if (solver == LINEAR_LS)
+            err = leastSquares(x, n / 2, &data);
+        if (err >= 0) {
+            /* Closed-form solution: one linear solve, no Jacobians */
+            info[5] = 1;
+            info[6] = 0;
+            info[7] = 1;
+            info[8] = 0;
+        } else {
+            levmar(CurveFitter::func<Order, T>,
+                solver == NUMERIC_LM ? 0 : CurveFitter::jacf<Order, T>, p, x,
+                m, n, m_options.maxIterations, info, work, &data);
+            err = info[1];
+        }
+        fitStats.solveTime += timer.nsecsElapsed();
+
+        /* Residuals */
+        fnormPrev = fnorm;
+        fnorm = err / sz;
+        if (fnorm < bestFnorm) {
+            bestFnorm = fnorm;
+            memcpy(bestPxy, data.pxy, sizeof(bestPxy));
+        }
+
+        int reason = info[6];
+        fitStats.outerIterations++;
+        fitStats.iterations += info[5];
+        fitStats.evaluations += info[7];
+        fitStats.jacobians += info[8];
+        if (reason >= 0 && reason < FitStats::TERMINATION_REASONS)
+            fitStats.terminations[reason]++;
+        fitStats.lastTermination = reason;
+        /* Quit, when improvement is less than minImprovement. Exact fit
+         * leaves nothing to improve, and 0 / 0 would compare false */
+        qreal improvement = (fnormPrev - fnorm) / fnormPrev;
+        if (fnormPrev == 0 || !(improvement >= m_options.minImprovement))
+            break;
+
+        /* Next round takes about as long as the last one, stop before
+         * it, when it would not fit into the budget */
+        qint64 now = clock.nsecsElapsed();
+        bool outOfTime = m_options.timeBudget > 0 &&
+            2 * now - roundStart > m_options.timeBudget;
+        roundStart = now;
+        if (outOfTime || (m_options.maxRounds > 0 &&
+                fitStats.outerIterations >= m_options.maxRounds)) {
+            fitStats.truncated = 1;
+            break;
+        }
+
+        /* Optimize point parameters */
+        timer.start();
+        bool done = reparametrizePoints<Order>(data.pxy, sz / 2, x, data.ts,
+            &clock, m_options.timeBudget);
+        fitStats.reparametrizationTime += timer.nsecsElapsed();
+        if (!done) {
+            fitStats.truncated = 1;
+            break;
+        }
+        updateBasis(&data);
+    } while (true);
+
+    if (fnorm > bestFnorm) {
+        fnorm = bestFnorm;
+        memcpy(data.pxy, bestPxy, sizeof(bestPxy));
+    }
+
+    if (ts) {
+        for (int i = 0; i < sz / 2; ++i)
+            ts[i] = data.ts[i];
+    }
+
+    if (stats) {
+        /* Distance of each point from the curve at its parameter, back
+         * in coordinates of points. NaN of a failed fit is kept */
+        T cx[Order], cy[Order], xy[2 * EVALUATE_CHUNK];
+        BezierEvaluator::powerBasis(Order, 1, data.pxy, cx, cy);
+        qreal maxError = 0;
+        for (int i = 0; i < sz / 2; ++i) {
+            int chunk = i % EVALUATE_CHUNK;
+            if (chunk == 0)
+                BezierEvaluator::evaluateBasis(Order, 1, cx, cy,
+                    qMin(EVALUATE_CHUNK, sz / 2 - i), data.ts + i, xy);
+            qreal dx = xy[2 * chunk] - x[2 * i];
+            qreal dy = xy[2 * chunk + 1] - x[2 * i + 1];
+            if (transformation == AFFINE) {
+                dx *= std[0];
+                dy *= std[1];
+            }
+            qreal dist = qSqrt(dx * dx + dy * dy);
+            if (dist > maxError || qIsNaN(dist))
+                maxError = dist;
+        }
+        fitStats.fits = 1;
+        fitStats.error = fnorm;
+        fitStats.maxError = maxError;
+        *stats = fitStats;
+    }
+
+    curve.resize(Order);
+    for (int i = 0; i < 2 * Order; i += 2) {
+        curve[i] = data.pxy[i];
+        curve[i + 1] = data.pxy[i + 1];
+        if (transformation == AFFINE) {
+            curve[i] = data.pxy[i] * std[0] + mean[0];
+            curve[i + 1] = data.pxy[i + 1] * std[1] + mean[1];
+        }
+    }
+
+    return fnorm;
+}
+
+/* Used directly by tests and benchmarks, other versions are instantiated
+ * by the fit() table */
+template void CurveFitter::chordLengthParam<qreal>(int len, const qreal *x,
+    qreal *ts, Parametrization parametrization);
+template bool CurveFitter::reparametrizePoints<SPLINE_ORDER, qreal>(
+    const qreal *pxy, int num, const qreal *x, qreal *ts,
+    const QElapsedTimer *clock, qint64 deadline);
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef CURVEFITTER_H
+#define CURVEFITTER_H
+
+#include <QtGlobal>
+
+#include "fitoptions.h"
+#include "fitstats.h"
+#include "fitworkspace.h"
+#include "pointarray.h"
+#include "strokeview.h"
+
+/* Order, number of control points, of curves fitted by default */
+#define SPLINE_ORDER 4
+/* Orders fit() is instantiated for, quadratic to quintic */
+#define MIN_FIT_ORDER 3
+#define MAX_FIT_ORDER 6
+
+class QElapsedTimer;
+
+/* CurveFitter keeps no shared mutable state, so threads may create
+ * fitters and call fit() or curve() concurrently. levmar is not
+ * reentrant as built by default, so its solves, NUMERIC_LM, ANALYTIC_LM
+ * and fallback of LINEAR_LS, run one at a time, unless the library is
+ * built with CONFIG+=levmar_reentrant against levmar built without
+ * LINSOLVERS_RETAIN_MEMORY. Each fitter reuses its FitWorkspace across
+ * fits, so one fitter serves one thread at a time, and settings must not
+ * be changed while it fits. */
+class CurveFitter
+{
+public:
+    CurveFitter();
+    ~CurveFitter();
+
+    enum Transformation { EUCLIDEAN, AFFINE };
+    /* NUMERIC_LM estimates Jacobian by finite differences,
+     * ANALYTIC_LM supplies exact one from Bernstein basis,
+     * LINEAR_LS solves normal equations directly, falling back
+     * to ANALYTIC_LM when they are singular */
+    enum Solver { NUMERIC_LM, ANALYTIC_LM, LINEAR_LS };
+    /* SINGLE solves in float, halving memory traffic of basis, points and
+     * parameters. Input and results stay qreal, normal equations and
+     * errors are summed up in qreal either way */
+    enum Precision { DOUBLE, SINGLE };
+
+    void setPrecision(Precision precision);
+    Precision precision() const;
+    void setOptions(const FitOptions &options);
+    const FitOptions &options() const;
+    /* Order of fitted curves from MIN_FIT_ORDER to MAX_FIT_ORDER, fits
+     * need at least that many points */
+    void setOrder(int order);
+    int order() const;
+    /* Scratch memory of fits, grows to the largest stroke fitted */
+    const FitWorkspace &workspace() const;
+
+    /* Returns mean squared error, stats are filled in when given. Points
+     * are read in place, PointArray and PointArraySoA convert to views */
+    qreal fit(const StrokeView &points, PointArray<256> &curve,
+        Transformation transformation, Solver solver = ANALYTIC_LM,
+        FitStats *stats = 0);
+    /* Warm started fit for a stroke that grew or shrank at its end since
+     * previous fit. curve and ts hold result of previous fit, where ts
+     * are parameters of leading points, and are updated in place. Empty
+     * ts or curve make it a cold fit */
+    qreal refit(const StrokeView &points, PointArray<256> &curve,
+        QVarLengthArray<qreal,256> &ts, Transformation transformation,
+        Solver solver = ANALYTIC_LM, FitStats *stats = 0);
+    /* Fits curves of increasing order from MIN_FIT_ORDER up to order()
+     * and keeps the first one, which is within tolerance of all points,
+     * or the one of order() otherwise. Returns largest distance of a
+     * point from the curve kept, stats are of its fit */
+    qreal fitLowestOrder(const StrokeView &points, PointArray<256> &curve,
+        qreal tolerance, Transformation transformation,
+        Solver solver = ANALYTIC_LM, FitStats *stats = 0);
+    /* Projects points onto closest points of curve, their parameters go
+     * to ts. Returns largest distance of a point from its projection,
+     * index of that point goes to worst, if given */
+    qreal project(const PointArray<256> &curve, const StrokeView &points,
+        qreal *ts, int *worst = 0);
+    PointArray<256> curve(const PointArray<256> &curve, int count);
+    /* Same as curve() above, samples go to separate x and y arrays */
+    void curve(const PointArray<256> &curve, int count,
+        PointArraySoA<256> &points);
+    /* Same as curve() above, samples go to caller's buffer of count
+     * interleaved points, such as data of QPolygonF */
+    void curve(const PointArray<256> &curve, int count, qreal *xy);
+    void splitCasteljau(const PointArray<256> &curve, qreal t,
+        PointArray<256> &left, PointArray<256> &right);
+
+    /* Minimum of func on [a, b] within epsilon. Kept for callers with
+     * function pointers, it runs Minimizer::brent(), which new code
+     * should call directly with a lambda */
+    qreal goldenSectionSearch(qreal (*func)(qreal x, void *data),
+        qreal a, qreal b, qreal epsilon, void *data);
+
+private:
+    template <int Order, typename T>
+    class InternalData
+    {
+    public:
+        /* Takes ts and basis from workspace */
+        InternalData(FitWorkspace &workspace, int size) : pxy(0),
+            ts(workspace.allocate<T>(size)),
+            basis(workspace.allocate<T>(size * Order)), size(size) {}
+
+        T *pxy;   /* Bezier spline of size 2 * Order */
+        T *ts;    /* Sample points of size n */
+        T *basis; /* Bernstein basis at ts of size n x Order */
+        int size; /* Number of sample points n */
+    };
+
+    class SectionData
+    {
+    public:
+        int order;  /* Number of control points of spline */
+        qreal *cx;  /* Power basis x coefficients of size order */
+        qreal *cy;  /* Power basis y coefficients of size order */
+        qreal *x;   /* Sample point of size 2 */
+    };
+
+    static qreal func3(double t, void *data);
+
+    /* Templates on scalar type T are instantiated for qreal and float,
+     * fitting ones on Order for MIN_FIT_ORDER to MAX_FIT_ORDER */
+    template <int Order, typename T>
+    static void bernstein(T t, T *b);
+    template <int Order, typename T>
+    static void updateBasis(InternalData<Order, T> *data);
+    static void point(const qreal *pxy, qreal t, qreal *xy);
+    static void point(int splineOrder, const qreal *pxy, qreal t, qreal *xy);
+    static void curve(int splineOrder, const qreal *pxy, int num, qreal *xy, const qreal *ts = 0);
+    /* Fixed order kernels with stack storage, runtime order versions
+     * dispatch to them for orders up to MAX_KERNEL_ORDER */
+    template <int Order, typename T>
+    static void point(const T *pxy, T t, T *xy);
+    template <int Order, typename T>
+    static void splitCasteljau(const T *pxy, T t, T *pxy1, T *pxy2);
+    template <int Order, typename T>
+    static void func(T *p, T *hx, int m, int n, void *data);
+    template <int Order, typename T>
+    static void jacf(T *p, T *jac, int m, int n, void *data);
+    template <int Order, typename T>
+    static qreal leastSquares(const T *x, int num,
+        InternalData<Order, T> *data);
+
+    static void splitCasteljau(int splineOrder, const qreal *pxy,
+        qreal t, qreal *pxy1, qreal *pxy2);
+
+    /* Point i is (px[i * stride], py[i * stride]), dispatches to fit of
+     * given order in current precision */
+    qreal fit(int order, const qreal *px, const qreal *py, int stride,
+        int num, PointArray<256> &curve, qreal *ts, int known,
+        Transformation transformation, Solver solver, FitStats *stats);
+    template <int Order, typename T>
+    qreal fit(const qreal *px, const qreal *py, int stride, int num,
+        PointArray<256> &curve, qreal *ts, int known,
+        Transformation transformation, Solver solver, FitStats *stats);
+    template <int Order, typename T>
+    static bool warmStart(int len, const T *x, int known,
+        const qreal *prevTs, const T *prevPxy, T *ts, T *pxy);
+
+    enum Parametrization { CHORD_LENGTH, CENTRIPETAL };
+    template <typename T>
+    void chordLengthParam(int len, const T *x, T *ts,
+        Parametrization parametrization);
+
+    /* Newton step from t towards closest point of curve to x, cx and cy
+     * hold power basis of curve, curve' and curve'', Order apart */
+    template <int Order, typename T>
+    T reparametrize(const T *cx, const T *cy, const T *x, T t);
+    /* Returns false, when clock passed deadline before all points were
+     * done, zero deadline means none */
+    template <int Order, typename T>
+    bool reparametrizePoints(const T *pxy, int num, const T *x, T *ts,
+        const QElapsedTimer *clock = 0, qint64 deadline = 0);
+
+    Precision m_precision;
+    int m_order;
+    FitOptions m_options;
+    FitWorkspace m_workspace;
+
+    friend class CurveTest;
+    friend class CurveBench;
+};
+
+#endif
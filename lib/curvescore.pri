@@ -0,0 +1,10 @@
+# Links against curvescore static library, include from users' .pro files
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# Stage tracing, see tracer.h
+trace: DEFINES += CURVES_TRACE
+
+LIBS += -L$$OUT_PWD/../lib -lcurvescore -lm -llevmar
+win32: PRE_TARGETDEPS += $$OUT_PWD/../lib/curvescore.lib
+else: PRE_TARGETDEPS += $$OUT_PWD/../lib/libcurvescore.a
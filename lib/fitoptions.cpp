@@ -0,0 +1,40 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "fitoptions.h"
+
+#define MAX_ITER 500
+#define MAX_ROUNDS 100
+/* Newton steps oscillate on some noisy strokes instead of converging,
+ * projection takes over after that many */
+#define MAX_NEWTON_ITER 8
+/* Quit, when improvement is less than 1% */
+#define MIN_IMPROVEMENT 0.01
+#define NEWTON_TOLERANCE 0.01
+
+FitOptions::FitOptions() :
+    maxIterations(MAX_ITER),
+    maxRounds(MAX_ROUNDS),
+    minImprovement(MIN_IMPROVEMENT),
+    exactProjection(false),
+    maxNewtonIterations(MAX_NEWTON_ITER),
+    newtonTolerance(NEWTON_TOLERANCE),
+    timeBudget(0)
+{
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FITOPTIONS_H
+#define FITOPTIONS_H
+
+#include <QtGlobal>
+
+/* Convergence controls of CurveFitter::fit. Default cap on rounds stops
+ * only fits of noise-free points, which keep improving down to rounding
+ * errors, and there is no time budget. Interactive callers may trade
+ * accuracy for latency with lower caps and a time budget. Both are
+ * checked between rounds of shape optimization and reparametrization,
+ * and no round is started that is expected to overrun the budget. A fit
+ * stopped by them returns the best curve found so far and is counted in
+ * FitStats::truncated. */
+struct FitOptions
+{
+    FitOptions();
+
+    int maxIterations;       /* Levmar iterations per shape optimization */
+    int maxRounds;           /* Shape and reparametrization rounds, 0 is
+                              * unlimited. Default only stops fits of
+                              * noise-free points, which keep improving
+                              * down to rounding errors */
+    qreal minImprovement;    /* Relative error decrease a round must make
+                              * for the next one to run */
+    bool exactProjection;    /* Reparametrize all points by closest
+                              * points found by BezierProjector, otherwise
+                              * only those where Newton steps from current
+                              * parameters do not converge */
+    int maxNewtonIterations; /* Newton steps per point parameter before
+                              * falling back to projection, so that
+                              * oscillating steps cannot stall a fit */
+    qreal newtonTolerance;   /* Relative parameter change ending them */
+    qint64 timeBudget;       /* Wall-clock time per fit in ns, 0 is
+                              * unlimited */
+};
+
+#endif // FITOPTIONS_H
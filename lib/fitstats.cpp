@@ -0,0 +1,85 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QDebug>
+
+#include "fitstats.h"
+
+FitStats::FitStats()
+{
+    reset();
+}
+
+void FitStats::reset()
+{
+    fits = 0;
+    outerIterations = 0;
+    iterations = 0;
+    evaluations = 0;
+    jacobians = 0;
+    for (int i = 0; i < TERMINATION_REASONS; ++i)
+        terminations[i] = 0;
+    lastTermination = 0;
+    truncated = 0;
+    error = 0;
+    maxError = 0;
+    solveTime = 0;
+    reparametrizationTime = 0;
+}
+
+FitStats &FitStats::operator+=(const FitStats &other)
+{
+    fits += other.fits;
+    outerIterations += other.outerIterations;
+    iterations += other.iterations;
+    evaluations += other.evaluations;
+    jacobians += other.jacobians;
+    for (int i = 0; i < TERMINATION_REASONS; ++i)
+        terminations[i] += other.terminations[i];
+    if (other.fits > 0)
+        lastTermination = other.lastTermination;
+    truncated += other.truncated;
+    error += other.error;
+    maxError = qMax(maxError, other.maxError);
+    solveTime += other.solveTime;
+    reparametrizationTime += other.reparametrizationTime;
+    return *this;
+}
+
+qreal FitStats::meanError() const
+{
+    return fits > 0 ? error / fits : 0;
+}
+
+QDebug operator<<(QDebug debug, const FitStats &stats)
+{
+    debug.nospace() << "FitStats(fits " << stats.fits
+        << ", rounds " << stats.outerIterations
+        << ", iterations " << stats.iterations
+        << ", evaluations " << stats.evaluations
+        << ", Jacobians " << stats.jacobians
+        << ", last termination " << stats.lastTermination
+        << ", truncated " << stats.truncated
+        << ", mean error " << stats.meanError()
+        << ", max error " << stats.maxError
+        << ", solve " << stats.solveTime * 1e-6 << " ms"
+        << ", reparametrization " << stats.reparametrizationTime * 1e-6
+        << " ms)";
+    return debug.space();
+}
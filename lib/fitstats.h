@@ -0,0 +1,60 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FITSTATS_H
+#define FITSTATS_H
+
+#include <QtGlobal>
+
+class QDebug;
+
+/* Counters of single CurveFitter::fit call, or sum of many of them */
+struct FitStats
+{
+    /* 0 is closed-form least squares solution, 1-7 are levmar
+     * termination reasons as in info[6] */
+    enum { TERMINATION_REASONS = 8 };
+
+    FitStats();
+
+    void reset();
+    FitStats &operator+=(const FitStats &other);
+
+    qreal meanError() const;
+
+    int fits;                /* Number of fit calls summed up */
+    int outerIterations;     /* Shape and reparametrization rounds */
+    int iterations;          /* Levmar iterations, 1 per linear solve */
+    int evaluations;         /* Function evaluations */
+    int jacobians;           /* Jacobian evaluations */
+    int terminations[TERMINATION_REASONS]; /* Rounds ended per reason */
+    int lastTermination;     /* Reason of the last round */
+    int truncated;           /* Fits stopped by FitOptions caps or time
+                              * budget before converging */
+    qreal error;             /* Mean squared residual of a coordinate
+                              * at the end of fit, summed over fits */
+    qreal maxError;          /* Largest distance of a point from the
+                              * curve at its parameter, over all fits */
+    qint64 solveTime;        /* Spent in shape optimization, ns */
+    qint64 reparametrizationTime; /* Spent in reparametrization, ns */
+};
+
+QDebug operator<<(QDebug debug, const FitStats &stats);
+
+#endif // FITSTATS_H
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "fitworkspace.h"
+
+FitWorkspace::FitWorkspace() :
+    m_data(0), m_capacity(0), m_used(0), m_allocations(0)
+{
+}
+
+FitWorkspace::FitWorkspace(const FitWorkspace &) :
+    m_data(0), m_capacity(0), m_used(0), m_allocations(0)
+{
+}
+
+FitWorkspace &FitWorkspace::operator=(const FitWorkspace &)
+{
+    return *this;
+}
+
+FitWorkspace::~FitWorkspace()
+{
+    release();
+}
+
+void FitWorkspace::reset(size_t bytes)
+{
+    m_used = 0;
+    if (bytes <= m_capacity)
+        return;
+
+    /* Grow by half again at least, so that strokes growing point by
+     * point do not reallocate on every fit */
+    size_t capacity = qMax(bytes, m_capacity + m_capacity / 2);
+    release();
+    m_data = static_cast<char*>(qMallocAligned(capacity, WORKSPACE_ALIGN));
+    Q_CHECK_PTR(m_data);
+    m_capacity = capacity;
+    m_allocations++;
+}
+
+void FitWorkspace::release()
+{
+    qFreeAligned(m_data);
+    m_data = 0;
+    m_capacity = 0;
+    m_used = 0;
+}
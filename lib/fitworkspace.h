@@ -0,0 +1,74 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef FITWORKSPACE_H
+#define FITWORKSPACE_H
+
+#include <QtGlobal>
+
+/* Alignment of every allocation, a cache line */
+#define WORKSPACE_ALIGN 64
+
+/* Arena of scratch memory for CurveFitter::fit(): copies of points,
+ * parameters, Bernstein basis and levmar work array. A fit reserves all
+ * it needs at once and takes buffers from it. Memory grows to the
+ * largest fit seen and is kept, so later fits up to that size do not
+ * touch the heap. A workspace serves one fit at a time. */
+class FitWorkspace
+{
+public:
+    FitWorkspace();
+    /* Copies start empty, memory is never shared */
+    FitWorkspace(const FitWorkspace &other);
+    FitWorkspace &operator=(const FitWorkspace &other);
+    ~FitWorkspace();
+
+    /* Makes room for bytes, as counted by size(), and takes back all
+     * earlier allocations. Grows only when room is too small */
+    void reset(size_t bytes);
+    /* count elements of T from room made by reset() */
+    template <typename T>
+    inline T *allocate(int count) {
+        size_t bytes = size<T>(count);
+        Q_ASSERT(m_used + bytes <= m_capacity);
+        T *data = reinterpret_cast<T*>(m_data + m_used);
+        m_used += bytes;
+        return data;
+    }
+    /* Bytes allocate() takes for count elements of T */
+    template <typename T>
+    static inline size_t size(int count) {
+        size_t bytes = count * sizeof(T);
+        return (bytes + WORKSPACE_ALIGN - 1) & ~(size_t)(WORKSPACE_ALIGN - 1);
+    }
+
+    /* Frees memory, next reset() allocates it again */
+    void release();
+    inline size_t capacity() const { return m_capacity; }
+    /* Heap allocations made so far */
+    inline int allocations() const { return m_allocations; }
+
+private:
+    char *m_data;
+    size_t m_capacity;
+    size_t m_used;
+    int m_allocations;
+};
+
+#endif // FITWORKSPACE_H
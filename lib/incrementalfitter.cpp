@@ -0,0 +1,211 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include "incrementalfitter.h"
+#include "strokeview.h"
+
+IncrementalFitter::IncrementalFitter(int tinySegment) :
+    m_detector(OUTLIER_MULTIPLIER, tinySegment),
+    m_previews(false),
+    m_piecewise(false),
+    m_openBegin(0),
+    m_previewStep(1)
+{
+}
+
+void IncrementalFitter::setPreviewBudget(qint64 budget)
+{
+    FitOptions options;
+    options.timeBudget = budget;
+    m_previewFitter.setOptions(options);
+    m_previews = budget > 0;
+}
+
+void IncrementalFitter::setCloseBudget(qint64 budget)
+{
+    FitOptions options;
+    options.timeBudget = budget;
+    m_fitter.setOptions(options);
+}
+
+void IncrementalFitter::setPiecewise(bool piecewise)
+{
+    m_piecewise = piecewise;
+}
+
+void IncrementalFitter::reset()
+{
+    m_detector.reset();
+    m_points.clear();
+    m_segments.clear();
+    m_openBegin = 0;
+    m_openCurve.clear();
+    m_openTs.clear();
+    m_previewStep = 1;
+    m_previewStats.reset();
+}
+
+bool IncrementalFitter::addPoint(const QPointF &point)
+{
+    m_points << point;
+
+    /* Corner confirmed by the last point closes open segment, even one
+     * too short for a curve, so that corners are never merged away */
+    int breakpoint = m_detector.addPoint(point);
+    if (breakpoint >= 0)
+        close(breakpoint + 1);
+
+    if (m_previews)
+        updatePreview();
+    return breakpoint >= 0;
+}
+
+void IncrementalFitter::updatePreview()
+{
+    /* Step only doubles, so every other sample stays and keeps its
+     * parameter for the warm start */
+    int count = m_points.count() - m_openBegin;
+    while ((count - 1) / m_previewStep + 1 > PREVIEW_POINTS) {
+        m_previewStep *= 2;
+        int known = (m_openTs.count() + 1) / 2;
+        for (int i = 0; i < known; ++i)
+            m_openTs[i] = m_openTs[2 * i];
+        m_openTs.resize(known);
+    }
+
+    /* Not enough points to define a curve yet */
+    int samples = (count - 1) / m_previewStep + 1;
+    if (samples < SPLINE_ORDER)
+        return;
+    const qreal *xy = m_points.constData() + 2 * m_openBegin;
+    StrokeView open(xy, xy + 1, samples, 2 * m_previewStep);
+    m_previewFitter.refit(open, m_openCurve, m_openTs,
+        CurveFitter::AFFINE, CurveFitter::LINEAR_LS, &m_previewStats);
+}
+
+int IncrementalFitter::finish()
+{
+    if (m_points.isEmpty())
+        return 0;
+
+    /* Statistics of whole stroke may move or drop provisional corners,
+     * segments closed at ones that stay are kept */
+    QVarLengthArray<int,128> breakpoints = m_detector.breakpoints(m_points);
+    int kept = 0;
+    while (kept < m_segments.count() && kept + 2 < breakpoints.count() &&
+            m_segments.at(kept).end == breakpoints.at(kept + 1) + 1)
+        ++kept;
+    if (kept < m_segments.count()) {
+        m_openBegin = m_segments.at(kept).begin;
+        m_segments.resize(kept);
+        /* Preview was of points after a dropped corner */
+        m_openCurve.clear();
+        m_openTs.clear();
+        m_previewStep = 1;
+    }
+
+    for (int i = kept + 1; i < breakpoints.count(); ++i)
+        close(breakpoints.at(i) + 1);
+    return kept;
+}
+
+void IncrementalFitter::fit(const StrokeView &points)
+{
+    reset();
+    for (int i = 0; i < points.count(); ++i) {
+        m_points << points.at(i);
+        m_detector.addPoint(points.at(i));
+    }
+    finish();
+}
+
+void IncrementalFitter::close(int end)
+{
+    Segment segment;
+    segment.begin = m_openBegin;
+    segment.end = end;
+
+    /* Points past the corner are left out */
+    StrokeView points =
+        StrokeView(m_points).mid(m_openBegin, end - m_openBegin + 1);
+    if (points.count() < SPLINE_ORDER) {
+        /* Not enough points to define a curve, segment gets none */
+    } else if (m_piecewise) {
+        segment.curve = m_piecewiseFitter.fit(points, &segment.knots,
+            &segment.stats);
+    } else {
+        /* Parameters of preview samples, interpolated for points between
+         * them, warm start the final fit */
+        QVarLengthArray<qreal,256> ts;
+        if (!m_openCurve.isEmpty()) {
+            int known = qMin((m_openTs.count() - 1) * m_previewStep + 1,
+                points.count());
+            ts.resize(known);
+            for (int j = 0; j < known; ++j) {
+                int k = j / m_previewStep;
+                int r = j % m_previewStep;
+                ts[j] = r == 0 ? m_openTs[k] : m_openTs[k] +
+                    (m_openTs[k + 1] - m_openTs[k]) * r / m_previewStep;
+            }
+        }
+        m_fitter.refit(points, m_openCurve, ts, CurveFitter::AFFINE,
+            CurveFitter::LINEAR_LS, &segment.stats);
+        segment.curve = m_openCurve;
+        segment.knots << 0 << end - m_openBegin;
+    }
+    m_segments << segment;
+
+    /* Next segment starts at the corner, from scratch */
+    m_openBegin = end;
+    m_openCurve.clear();
+    m_openTs.clear();
+    m_previewStep = 1;
+    m_previewStats.reset();
+}
+
+const PointArray<256> &IncrementalFitter::points() const
+{
+    return m_points;
+}
+
+const QVector<IncrementalFitter::Segment> &IncrementalFitter::segments() const
+{
+    return m_segments;
+}
+
+int IncrementalFitter::openBegin() const
+{
+    return m_openBegin;
+}
+
+const PointArray<256> &IncrementalFitter::preview() const
+{
+    return m_openCurve;
+}
+
+const FitStats &IncrementalFitter::previewStats() const
+{
+    return m_previewStats;
+}
+
+int IncrementalFitter::previewPoints() const
+{
+    return m_openTs.count();
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifndef INCREMENTALFITTER_H
+#define INCREMENTALFITTER_H
+
+#include <QPointF>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include "cornerdetector.h"
+#include "curvefitter.h"
+#include "fitstats.h"
+#include "piecewisefitter.h"
+#include "pointarray.h"
+#include "strokeview.h"
+
+/* Most points a preview is fitted to */
+#define PREVIEW_POINTS 64
+
+/* Fits a stroke while it is drawn. Provisional corners confirmed by
+ * CornerDetector close segments, however short, which are fitted at once.
+ * The open segment after the last corner is refitted on every point
+ * within a preview budget, warm started from its previous fit. Long open
+ * segments are thinned out to PREVIEW_POINTS for it, so a refit costs the
+ * same however long the stroke gets. When the stroke ends, finish()
+ * segments it at breakpoints of the whole stroke, the same as
+ * StrokeAnalyzer::breakpoints, keeps closed segments which end at them
+ * and fits the rest, warm started from the preview where it covers them.
+ * Closed segments get a single cubic curve, or as many as
+ * PiecewiseFitter needs, if piecewise. */
+class IncrementalFitter
+{
+public:
+    struct Segment
+    {
+        int begin;             /* First and last point of segment */
+        int end;
+        PointArray<256> curve; /* Composite spline of 3 * k + 1 control
+                                * points, k is 1 unless piecewise. Empty
+                                * for less than SPLINE_ORDER points */
+        QVarLengthArray<int,64> knots; /* Piece i fits points begin +
+                                        * knots[i] to begin + knots[i + 1] */
+        FitStats stats;        /* Stats of its final fits */
+    };
+
+    explicit IncrementalFitter(int tinySegment = TINY_SEGMENT);
+
+    /* Time budget of open segment refits in ns, 0 disables them */
+    void setPreviewBudget(qint64 budget);
+    /* Time budget of each final fit of a closed segment in ns, 0 fits
+     * them to convergence */
+    void setCloseBudget(qint64 budget);
+    /* Fit closed segments with PiecewiseFitter. Previews stay single
+     * curves either way */
+    void setPiecewise(bool piecewise);
+
+    void reset();
+    /* Adds next point of stroke. Returns true, when the point confirmed
+     * a provisional corner, which closed segments().last() */
+    bool addPoint(const QPointF &point);
+    /* Segments stroke at its final breakpoints and fits segments which
+     * were not closed at them yet. Returns count of leading segments
+     * kept from those closed while it was drawn */
+    int finish();
+    /* Fits whole stroke at once, the same as adding its points and
+     * finishing, without provisional segments */
+    void fit(const StrokeView &points);
+
+    const PointArray<256> &points() const;
+    /* Segments closed so far */
+    const QVector<Segment> &segments() const;
+    /* Open segment runs from point openBegin() to the last one. Its
+     * preview is empty while it has too few points to define a curve */
+    int openBegin() const;
+    const PointArray<256> &preview() const;
+    const FitStats &previewStats() const;
+    /* Points of open segment the preview was fitted to */
+    int previewPoints() const;
+
+private:
+    void updatePreview();
+    void close(int end);
+
+    CornerDetector m_detector;
+    /* Closed segments are fitted within close budget */
+    CurveFitter m_fitter;
+    CurveFitter m_previewFitter;
+    bool m_previews;
+    PiecewiseFitter m_piecewiseFitter;
+    bool m_piecewise;
+
+    PointArray<256> m_points;
+    QVector<Segment> m_segments;
+    int m_openBegin;
+    /* Preview and its point parameters seed the next refit. It fits
+     * every m_previewStep-th point of open segment */
+    PointArray<256> m_openCurve;
+    QVarLengthArray<qreal,256> m_openTs;
+    int m_previewStep;
+    FitStats m_previewStats;
+};
+
+#endif // INCREMENTALFITTER_H
@@ -0,0 +1,40 @@
+TEMPLATE = lib
+TARGET = curvescore
+CONFIG += staticlib c++14
+
+QT -= gui
+
+trace: DEFINES += CURVES_TRACE
+# levmar built without LINSOLVERS_RETAIN_MEMORY solves concurrently
+levmar_reentrant: DEFINES += CURVES_LEVMAR_REENTRANT
+
+HEADERS += curvefitter.h
+SOURCES += curvefitter.cpp
+HEADERS += fitstats.h
+SOURCES += fitstats.cpp
+HEADERS += fitoptions.h
+SOURCES += fitoptions.cpp
+HEADERS += fitworkspace.h
+SOURCES += fitworkspace.cpp
+HEADERS += beziereval.h
+SOURCES += beziereval.cpp
+HEADERS += bezierprojector.h
+SOURCES += bezierprojector.cpp
+HEADERS += batchfitter.h
+SOURCES += batchfitter.cpp
+HEADERS += piecewisefitter.h
+SOURCES += piecewisefitter.cpp
+HEADERS += strokeanalyzer.h
+SOURCES += strokeanalyzer.cpp
+HEADERS += cornerdetector.h
+SOURCES += cornerdetector.cpp
+HEADERS += incrementalfitter.h
+SOURCES += incrementalfitter.cpp
+HEADERS += minimizer.h
+HEADERS += pointarray.h
+HEADERS += pointarraysoa.h
+HEADERS += strokeview.h
+HEADERS += tracer.h
+SOURCES += tracer.cpp
+HEADERS += utils.h
+SOURCES += utils.cpp
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef MINIMIZER_H
+#define MINIMIZER_H
+
+#include <QtCore/qmath.h>
+#include <QVarLengthArray>
+
+/* Iterations of Brent's method before it gives up on epsilon */
+#define BRENT_MAX_ITER 100
+/* 2 - golden ratio */
+#define BRENT_GOLDEN 0.38196601125010515
+/* Relative tolerance, sqrt of double epsilon */
+#define BRENT_RELATIVE 1.4901161193847656e-08
+
+/* Brent's method minimizes a unimodal function on [a, b] by parabolic
+ * interpolation through its three best points, falling back to golden
+ * section steps whenever a parabola is not trusted. Convergence is
+ * superlinear on smooth functions and never worse than golden section.
+ * Functions are any callables, which get inlined into the loop. */
+class Minimizer
+{
+public:
+    /* Returns x within about epsilon of minimum of func(x) on [a, b],
+     * function value there goes to fmin and count of calls to
+     * evaluations, if given */
+    template <typename Func>
+    static qreal brent(Func func, qreal a, qreal b, qreal epsilon,
+        qreal *fmin = 0, int *evaluations = 0);
+
+    /* Minimizes num independent functions in lockstep, problem i on
+     * [a[i], b[i]], minima go to xmin. func(const qreal *u, qreal *fu)
+     * evaluates all num of them at once, fu[i] being value of i-th one
+     * at u[i], so it may be a vectorized kernel. Problems that converged
+     * keep asking for their minimum. Per lane bookkeeping is branch free,
+     * for the compiler to vectorize. Returns count of func calls */
+    template <typename Func>
+    static int brent(Func func, int num, const qreal *a, const qreal *b,
+        qreal epsilon, qreal *xmin, qreal *fmin = 0);
+};
+
+template <typename Func>
+qreal Minimizer::brent(Func func, qreal a, qreal b, qreal epsilon,
+    qreal *fmin, int *evaluations)
+{
+    /* x is best point so far, w second best, v previous value of w */
+    qreal x = a + BRENT_GOLDEN * (b - a);
+    qreal w = x, v = x;
+    qreal fx = func(x);
+    qreal fw = fx, fv = fx;
+    /* d is last step, e the one before it */
+    qreal d = 0, e = 0;
+    int count = 1;
+
+    for (int iter = 0; iter < BRENT_MAX_ITER; ++iter) {
+        qreal xm = (a + b) / 2;
+        qreal tol1 = BRENT_RELATIVE * qAbs(x) + epsilon / 2;
+        qreal tol2 = 2 * tol1;
+        if (qAbs(x - xm) <= tol2 - (b - a) / 2)
+            break;
+
+        bool golden = true;
+        if (qAbs(e) > tol1) {
+            /* Parabola through x, w and v */
+            qreal r = (x - w) * (fx - fv);
+            qreal q = (x - v) * (fx - fw);
+            qreal p = (x - v) * q - (x - w) * r;
+            q = 2 * (q - r);
+            if (q > 0)
+                p = -p;
+            q = qAbs(q);
+            /* Accept its minimum, when it is inside [a, b] and step is
+             * less than half of the one before last */
+            if (qAbs(p) < qAbs(q * e / 2) && p > q * (a - x) &&
+                    p < q * (b - x)) {
+                e = d;
+                d = p / q;
+                qreal u = x + d;
+                if (u - a < tol2 || b - u < tol2)
+                    d = xm >= x ? tol1 : -tol1;
+                golden = false;
+            }
+        }
+        if (golden) {
+            e = x >= xm ? a - x : b - x;
+            d = BRENT_GOLDEN * e;
+        }
+
+        qreal u = qAbs(d) >= tol1 ? x + d : x + (d >= 0 ? tol1 : -tol1);
+        qreal fu = func(u);
+        ++count;
+
+        if (fu <= fx) {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w;
+            fv = fw;
+            w = x;
+            fw = fx;
+            x = u;
+            fx = fu;
+        } else {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x) {
+                v = w;
+                fv = fw;
+                w = u;
+                fw = fu;
+            } else if (fu <= fv || v == x || v == w) {
+                v = u;
+                fv = fu;
+            }
+        }
+    }
+
+    if (fmin)
+        *fmin = fx;
+    if (evaluations)
+        *evaluations = count;
+    return x;
+}
+
+template <typename Func>
+int Minimizer::brent(Func func, int num, const qreal *a, const qreal *b,
+    qreal epsilon, qreal *xmin, qreal *fmin)
+{
+    /* Same state as in scalar version, one lane per problem */
+    QVarLengthArray<qreal, 64> lo(num), hi(num), w(num), v(num);
+    QVarLengthArray<qreal, 64> fx(num), fw(num), fv(num), d(num), e(num);
+    QVarLengthArray<qreal, 64> u(num), fu(num);
+    qreal *x = xmin;
+
+    for (int i = 0; i < num; ++i) {
+        lo[i] = a[i];
+        hi[i] = b[i];
+        x[i] = w[i] = v[i] = a[i] + BRENT_GOLDEN * (b[i] - a[i]);
+        d[i] = e[i] = 0;
+    }
+    func(x, fx.data());
+    for (int i = 0; i < num; ++i)
+        fw[i] = fv[i] = fx[i];
+    int count = 1;
+
+    for (int iter = 0; iter < BRENT_MAX_ITER; ++iter) {
+        int active = 0;
+        for (int i = 0; i < num; ++i) {
+            qreal xm = (lo[i] + hi[i]) / 2;
+            qreal tol1 = BRENT_RELATIVE * qAbs(x[i]) + epsilon / 2;
+            qreal tol2 = 2 * tol1;
+            bool done = qAbs(x[i] - xm) <= tol2 - (hi[i] - lo[i]) / 2;
+            active += !done;
+
+            qreal r = (x[i] - w[i]) * (fx[i] - fv[i]);
+            qreal q = (x[i] - v[i]) * (fx[i] - fw[i]);
+            qreal p = (x[i] - v[i]) * q - (x[i] - w[i]) * r;
+            q = 2 * (q - r);
+            p = q > 0 ? -p : p;
+            q = qAbs(q);
+            bool parabolic = qAbs(e[i]) > tol1 &&
+                qAbs(p) < qAbs(q * e[i] / 2) &&
+                p > q * (lo[i] - x[i]) && p < q * (hi[i] - x[i]);
+            /* Guarded divisor, quotient is used only when q is not 0 */
+            qreal dp = p / (parabolic ? q : 1);
+            qreal up = x[i] + dp;
+            dp = (up - lo[i] < tol2 || hi[i] - up < tol2) ?
+                (xm >= x[i] ? tol1 : -tol1) : dp;
+            qreal eg = x[i] >= xm ? lo[i] - x[i] : hi[i] - x[i];
+
+            qreal step = parabolic ? dp : BRENT_GOLDEN * eg;
+            e[i] = done ? e[i] : (parabolic ? d[i] : eg);
+            d[i] = done ? d[i] : step;
+            qreal next = qAbs(step) >= tol1 ? x[i] + step :
+                x[i] + (step >= 0 ? tol1 : -tol1);
+            u[i] = done ? x[i] : next;
+        }
+        if (active == 0)
+            break;
+
+        func(u.constData(), fu.data());
+        ++count;
+
+        for (int i = 0; i < num; ++i) {
+            /* Converged lanes got x back and keep their state */
+            bool better = fu[i] <= fx[i];
+            bool same = u[i] == x[i];
+            bool right = u[i] >= x[i];
+            /* Bracket shrinks to the side of u or x, which is not best */
+            qreal cut = better ? x[i] : u[i];
+            bool cutLo = better ? right : !right;
+            lo[i] = (!same && cutLo) ? cut : lo[i];
+            hi[i] = (!same && !cutLo) ? cut : hi[i];
+
+            bool toW = !better && (fu[i] <= fw[i] || w[i] == x[i]);
+            bool toV = !better && !toW &&
+                (fu[i] <= fv[i] || v[i] == x[i] || v[i] == w[i]);
+            bool shift = !same && (better || toW);
+            qreal nv = shift ? w[i] : (!same && toV ? u[i] : v[i]);
+            qreal nfv = shift ? fw[i] : (!same && toV ? fu[i] : fv[i]);
+            qreal nw = !same && better ? x[i] : (!same && toW ? u[i] : w[i]);
+            qreal nfw = !same && better ? fx[i] :
+                (!same && toW ? fu[i] : fw[i]);
+            v[i] = nv;
+            fv[i] = nfv;
+            w[i] = nw;
+            fw[i] = nfw;
+            x[i] = !same && better ? u[i] : x[i];
+            fx[i] = !same && better ? fu[i] : fx[i];
+        }
+    }
+
+    if (fmin) {
+        for (int i = 0; i < num; ++i)
+            fmin[i] = fx[i];
+    }
+    return count;
+}
+
+#endif // MINIMIZER_H
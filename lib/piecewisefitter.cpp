@@ -0,0 +1,314 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QtCore/qmath.h>
+
+#include "piecewisefitter.h"
+#include "tracer.h"
+
+#define DEFAULT_TOLERANCE 1.0
+#define DEFAULT_MAX_SEGMENT_POINTS 256
+/* Pieces are cubic, each has 3 control points of its own */
+#define PIECE_STEP (SPLINE_ORDER - 1)
+/* Alternations of tangent constrained fit and projection */
+#define TANGENT_ROUNDS 4
+/* Joints turning by more than 45 degrees are corners, not smoothed */
+#define CORNER_COSINE 0.7071067811865476
+
+static inline qreal dot(const QPointF &a, const QPointF &b)
+{
+    return a.x() * b.x() + a.y() * b.y();
+}
+
+/* Unit vector of v, zero vector stays zero */
+static inline QPointF unit(const QPointF &v)
+{
+    qreal length = qSqrt(dot(v, v));
+    return length > 0 ? v / length : QPointF();
+}
+
+static inline bool isNull(const QPointF &v)
+{
+    return v.x() == 0 && v.y() == 0;
+}
+
+PiecewiseFitter::PiecewiseFitter() :
+    m_tolerance(DEFAULT_TOLERANCE),
+    m_maxSegmentPoints(DEFAULT_MAX_SEGMENT_POINTS),
+    m_sharedTangents(true),
+    m_transformation(CurveFitter::AFFINE),
+    m_solver(CurveFitter::LINEAR_LS)
+{
+}
+
+void PiecewiseFitter::setTolerance(qreal tolerance)
+{
+    m_tolerance = tolerance;
+}
+
+void PiecewiseFitter::setMaxSegmentPoints(int count)
+{
+    /* Halving must leave enough points for a cubic on both sides */
+    m_maxSegmentPoints = qMax(count, 2 * SPLINE_ORDER);
+}
+
+void PiecewiseFitter::setSharedTangents(bool shared)
+{
+    m_sharedTangents = shared;
+}
+
+void PiecewiseFitter::setTransformation(
+    CurveFitter::Transformation transformation)
+{
+    m_transformation = transformation;
+}
+
+void PiecewiseFitter::setSolver(CurveFitter::Solver solver)
+{
+    m_solver = solver;
+}
+
+int PiecewiseFitter::pieceCount(const PointArray<256> &spline)
+{
+    return spline.count() > 1 ? (spline.count() - 1) / PIECE_STEP : 0;
+}
+
+PointArray<256> PiecewiseFitter::piece(const PointArray<256> &spline, int i)
+{
+    PointArray<256> curve;
+    for (int j = 0; j < SPLINE_ORDER; ++j)
+        curve << spline.at(i * PIECE_STEP + j);
+    return curve;
+}
+
+PointArray<256> PiecewiseFitter::fit(const StrokeView &points,
+    QVarLengthArray<int,64> *knots, FitStats *stats)
+{
+    TRACE_SCOPE("piecewise fit");
+    PointArray<256> spline;
+    if (knots)
+        knots->clear();
+    if (stats)
+        stats->reset();
+    int num = points.count();
+    if (num < 2)
+        return spline;
+
+    /* Piece lists are kept between fits for their capacity, clear()
+     * keeps it since Qt 5.7 */
+    QVector<Piece> &pieces = m_pieces;
+    QVector<Piece> &next = m_next;
+    pieces.clear();
+    subdivide(points, 0, num - 1, -1, pieces, stats);
+
+    /* Constrained pieces fit worse than free ones, those which exceed
+     * tolerance then are split further and all joints are redone. Every
+     * pass adds pieces, so this ends */
+    while (m_sharedTangents && pieces.count() > 1) {
+        shareTangents(points, pieces);
+
+        next.clear();
+        for (int i = 0; i < pieces.count(); ++i) {
+            const Piece &piece = pieces.at(i);
+            if (piece.error > m_tolerance && canSplit(piece)) {
+                int count = piece.end - piece.begin + 1;
+                int split = piece.begin + qBound(SPLINE_ORDER - 1,
+                    piece.worst, count - SPLINE_ORDER);
+                subdivide(points, piece.begin, piece.end, split, next, stats);
+            } else {
+                next.append(piece);
+            }
+        }
+        if (next.count() == pieces.count())
+            break;
+        pieces.swap(next);
+    }
+
+    if (knots)
+        *knots << 0;
+    for (int i = 0; i < pieces.count(); ++i) {
+        const Piece &piece = pieces.at(i);
+        /* Joint is the stroke point both pieces interpolate */
+        for (int j = i == 0 ? 0 : 1; j < SPLINE_ORDER; ++j)
+            spline << piece.curve.at(j);
+        if (knots)
+            *knots << piece.end;
+    }
+    return spline;
+}
+
+bool PiecewiseFitter::canSplit(const Piece &piece) const
+{
+    /* Both halves need enough points for a cubic */
+    return piece.end - piece.begin + 1 >= 2 * SPLINE_ORDER - 1;
+}
+
+/* Fits points begin to end, split at split first, if it is not -1, and
+ * appends resulting pieces in order */
+void PiecewiseFitter::subdivide(const StrokeView &points, int begin, int end,
+    int split, QVector<Piece> &pieces, FitStats *stats)
+{
+    /* Ranges of points still to fit, first and last point included.
+     * Right half is pushed first, so that pieces come out in order */
+    struct Range { int begin, end; };
+    QVarLengthArray<Range, 64> ranges;
+    if (split >= 0) {
+        Range right = { split, end };
+        Range left = { begin, split };
+        ranges.append(right);
+        ranges.append(left);
+    } else {
+        Range whole = { begin, end };
+        ranges.append(whole);
+    }
+
+    FitStats fitStats;
+    while (!ranges.isEmpty()) {
+        Range range = ranges.last();
+        ranges.removeLast();
+        int count = range.end - range.begin + 1;
+
+        split = -1;
+        if (count > m_maxSegmentPoints) {
+            split = range.begin + count / 2;
+        } else {
+            Piece piece;
+            piece.begin = range.begin;
+            piece.end = range.end;
+            StrokeView segment = points.mid(range.begin, count);
+            QPointF p0 = segment.first(), p1 = segment.last();
+            if (count < SPLINE_ORDER) {
+                /* Too few points for a fit, straight line then */
+                for (int j = 0; j < SPLINE_ORDER; ++j)
+                    piece.fitted << p0 + (p1 - p0) * j / (SPLINE_ORDER - 1);
+                for (int j = 0; j < count; ++j)
+                    piece.ts.append((qreal) j / (count - 1));
+            } else {
+                m_fitter.refit(segment, piece.fitted, piece.ts,
+                    m_transformation, m_solver, &fitStats);
+                if (stats)
+                    *stats += fitStats;
+                /* End points are interpolated, make them exact */
+                piece.fitted[0] = p0.x();
+                piece.fitted[1] = p0.y();
+                piece.fitted[2 * SPLINE_ORDER - 2] = p1.x();
+                piece.fitted[2 * SPLINE_ORDER - 1] = p1.y();
+            }
+            piece.curve = piece.fitted;
+            piece.error = m_fitter.project(piece.curve, segment,
+                piece.ts.data(), &piece.worst);
+
+            if (piece.error > m_tolerance && canSplit(piece)) {
+                split = range.begin + qBound(SPLINE_ORDER - 1, piece.worst,
+                    count - SPLINE_ORDER);
+            } else {
+                pieces.append(piece);
+            }
+        }
+
+        if (split >= 0) {
+            Range right = { split, range.end };
+            Range left = { range.begin, split };
+            ranges.append(right);
+            ranges.append(left);
+        }
+    }
+}
+
+void PiecewiseFitter::shareTangents(const StrokeView &points,
+    QVector<Piece> &pieces)
+{
+    /* Joint tangent is the mean of directions of free fits meeting there.
+     * It is zero at corners, where pieces keep their own directions */
+    int num = pieces.count();
+    QVarLengthArray<QPointF, 64> tangents(num + 1);
+    for (int i = 1; i < num; ++i) {
+        const PointArray<256> &in = pieces.at(i - 1).fitted;
+        const PointArray<256> &out = pieces.at(i).fitted;
+        QPointF inDir = unit(in.at(SPLINE_ORDER - 1) - in.at(SPLINE_ORDER - 2));
+        QPointF outDir = unit(out.at(1) - out.at(0));
+        if (dot(inDir, outDir) >= CORNER_COSINE)
+            tangents[i] = unit(inDir + outDir);
+    }
+
+    for (int i = 0; i < num; ++i) {
+        Piece &piece = pieces[i];
+        const PointArray<256> &fitted = piece.fitted;
+        QPointF p0 = fitted.first(), p3 = fitted.last();
+
+        /* t1 points into the piece from its start, t2 from its end */
+        QPointF t1 = i > 0 ? tangents[i] : QPointF();
+        if (isNull(t1))
+            t1 = unit(fitted.at(1) - p0);
+        if (isNull(t1))
+            t1 = unit(p3 - p0);
+        QPointF t2 = i < num - 1 ? -tangents[i + 1] : QPointF();
+        if (isNull(t2))
+            t2 = unit(fitted.at(SPLINE_ORDER - 2) - p3);
+        if (isNull(t2))
+            t2 = unit(p0 - p3);
+
+        StrokeView segment = points.mid(piece.begin,
+            piece.end - piece.begin + 1);
+        for (int r = 0; r < TANGENT_ROUNDS; ++r) {
+            fitAlphas(segment, t1, t2, piece);
+            piece.error = m_fitter.project(piece.curve, segment,
+                piece.ts.data(), &piece.worst);
+        }
+    }
+}
+
+/* Least squares distances of inner control points from end points along
+ * fixed tangents, as in Schneider's "An Algorithm for Automatically
+ * Fitting Digitized Curves", Graphics Gems, 1990 */
+void PiecewiseFitter::fitAlphas(const StrokeView &segment, const QPointF &t1,
+    const QPointF &t2, Piece &piece)
+{
+    QPointF p0 = segment.first(), p3 = segment.last();
+    qreal c[2][2] = { { 0, 0 }, { 0, 0 } };
+    qreal x[2] = { 0, 0 };
+    for (int i = 0; i < segment.count(); ++i) {
+        qreal u = piece.ts[i], v = 1 - u;
+        qreal b0 = v * v * v, b1 = 3 * u * v * v;
+        qreal b2 = 3 * u * u * v, b3 = u * u * u;
+        QPointF a1 = t1 * b1, a2 = t2 * b2;
+        c[0][0] += dot(a1, a1);
+        c[0][1] += dot(a1, a2);
+        c[1][1] += dot(a2, a2);
+        QPointF rest = segment.at(i) - (p0 * (b0 + b1) + p3 * (b2 + b3));
+        x[0] += dot(a1, rest);
+        x[1] += dot(a2, rest);
+    }
+    c[1][0] = c[0][1];
+
+    qreal chord = qSqrt(dot(p3 - p0, p3 - p0));
+    qreal epsilon = 1e-6 * chord;
+    qreal det = c[0][0] * c[1][1] - c[0][1] * c[1][0];
+    qreal alpha1 = 0, alpha2 = 0;
+    if (qAbs(det) > 1e-12 * qMax(c[0][0] * c[1][1], qreal(1e-300))) {
+        alpha1 = (x[0] * c[1][1] - x[1] * c[0][1]) / det;
+        alpha2 = (c[0][0] * x[1] - c[1][0] * x[0]) / det;
+    }
+    /* Degenerate or backward solution, fall back to Wu-Barsky heuristic */
+    if (alpha1 < epsilon || alpha2 < epsilon)
+        alpha1 = alpha2 = chord / 3;
+
+    piece.curve.clear();
+    piece.curve << p0 << p0 + t1 * alpha1 << p3 + t2 * alpha2 << p3;
+}
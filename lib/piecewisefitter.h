@@ -0,0 +1,88 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PIECEWISEFITTER_H
+#define PIECEWISEFITTER_H
+
+#include <QVarLengthArray>
+#include <QVector>
+
+#include "curvefitter.h"
+#include "fitstats.h"
+#include "pointarray.h"
+#include "strokeview.h"
+
+/* Fits a stroke with a chain of cubic Bezier curves. A piece that is
+ * farther than tolerance from some of its points is split at the worst
+ * one and both halves are fitted again. Pieces longer than
+ * maxSegmentPoints are halved before fitting, so every fit stays small. */
+class PiecewiseFitter
+{
+public:
+    PiecewiseFitter();
+
+    /* Largest allowed distance of a point from the spline. Pieces of less
+     * than 2 * SPLINE_ORDER - 1 points are not split and may exceed it */
+    void setTolerance(qreal tolerance);
+    void setMaxSegmentPoints(int count);
+    /* Pieces meeting at a joint share its tangent, so that the spline is
+     * smooth where it was split */
+    void setSharedTangents(bool shared);
+    void setTransformation(CurveFitter::Transformation transformation);
+    void setSolver(CurveFitter::Solver solver);
+
+    /* Returns composite spline of 3 * k + 1 control points, neighbouring
+     * pieces share end points. Piece i fits points knots[i] to
+     * knots[i + 1], if knots are given. Stats of all fits are summed up */
+    PointArray<256> fit(const StrokeView &points,
+        QVarLengthArray<int,64> *knots = 0, FitStats *stats = 0);
+
+    static int pieceCount(const PointArray<256> &spline);
+    static PointArray<256> piece(const PointArray<256> &spline, int i);
+
+private:
+    struct Piece
+    {
+        int begin;                /* First and last point of piece */
+        int end;
+        PointArray<256> fitted;   /* Unconstrained fit */
+        PointArray<256> curve;    /* Result, fitted or with shared tangents */
+        QVarLengthArray<qreal,256> ts; /* Projections of points on curve */
+        qreal error;              /* Largest distance from curve */
+        int worst;                /* Index of point at that distance */
+    };
+
+    bool canSplit(const Piece &piece) const;
+    void subdivide(const StrokeView &points, int begin, int end, int split,
+        QVector<Piece> &pieces, FitStats *stats);
+    void shareTangents(const StrokeView &points, QVector<Piece> &pieces);
+    void fitAlphas(const StrokeView &points, const QPointF &t1,
+        const QPointF &t2, Piece &piece);
+
+    CurveFitter m_fitter;
+    QVector<Piece> m_pieces;
+    QVector<Piece> m_next;
+    qreal m_tolerance;
+    int m_maxSegmentPoints;
+    bool m_sharedTangents;
+    CurveFitter::Transformation m_transformation;
+    CurveFitter::Solver m_solver;
+};
+
+#endif // PIECEWISEFITTER_H
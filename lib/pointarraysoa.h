@@ -0,0 +1,100 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef POINT_ARRAY_SOA_H
+#define POINT_ARRAY_SOA_H
+
+#include <QVarLengthArray>
+#include <QPointF>
+
+#include "pointarray.h"
+
+/* Points as separate arrays of x and y coordinates, so that kernels load
+ * contiguous lanes of one coordinate instead of striding over PointArray.
+ * Arrays are deliberately left with QVarLengthArray alignment, that of
+ * qreal: kernels read through StrokeView, which also wraps external
+ * buffers of any alignment, so they use unaligned loads, and the fitter
+ * copies points into its aligned FitWorkspace anyway */
+template <int Prealloc>
+class PointArraySoA
+{
+public:
+    inline explicit PointArraySoA(int size = 0) : m_x(size), m_y(size) {};
+    template <int P>
+    inline explicit PointArraySoA(const PointArray<P> &points) {
+        fromPointArray(points);
+    };
+    inline ~PointArraySoA() {};
+
+    inline QPointF at(int i) const { return QPointF(m_x.at(i), m_y.at(i)); };
+    inline QPointF first(void) const { return at(0); };
+    inline QPointF last(void) const  { return at(count() - 1); };
+
+    inline qreal x(int i) const { return m_x.at(i); };
+    inline qreal y(int i) const { return m_y.at(i); };
+    inline qreal *xData(void) { return m_x.data(); };
+    inline qreal *yData(void) { return m_y.data(); };
+    inline const qreal *xData(void) const { return m_x.constData(); };
+    inline const qreal *yData(void) const { return m_y.constData(); };
+
+    inline int count(void) const { return m_x.count(); };
+    inline bool isEmpty(void) const { return m_x.isEmpty(); };
+    inline void clear(void) { m_x.clear(); m_y.clear(); };
+    inline void resize(int size) { m_x.resize(size); m_y.resize(size); };
+    inline void removeLast(void) { m_x.removeLast(); m_y.removeLast(); };
+
+    inline PointArraySoA<Prealloc> &operator<< (const QPointF &value) {
+        m_x.append(value.x());
+        m_y.append(value.y());
+        return *this;
+    };
+
+    template <int P>
+    void fromPointArray(const PointArray<P> &points) {
+        int num = points.count();
+        resize(num);
+        const qreal *xy = points.constData();
+        qreal *x = m_x.data();
+        qreal *y = m_y.data();
+        for (int i = 0; i < num; ++i) {
+            x[i] = xy[2 * i];
+            y[i] = xy[2 * i + 1];
+        }
+    };
+
+    PointArray<Prealloc> toPointArray(void) const {
+        int num = count();
+        PointArray<Prealloc> points;
+        points.resize(num);
+        qreal *xy = points.data();
+        const qreal *x = m_x.constData();
+        const qreal *y = m_y.constData();
+        for (int i = 0; i < num; ++i) {
+            xy[2 * i] = x[i];
+            xy[2 * i + 1] = y[i];
+        }
+        return points;
+    };
+
+private:
+    QVarLengthArray<qreal, Prealloc> m_x;
+    QVarLengthArray<qreal, Prealloc> m_y;
+};
+
+#endif // POINT_ARRAY_SOA_H
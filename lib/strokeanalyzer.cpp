@@ -0,0 +1,426 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <QtCore/qmath.h>
+#include <QPointF>
+
+#include "strokeanalyzer.h"
+#include "tracer.h"
+
+/* Kernels over separate x and y arrays are built with per-function target
+ * attributes, as in BezierEvaluator */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(QT_COORD_TYPE)
+#define STROKE_X86
+#include <immintrin.h>
+#endif
+
+QVarLengthArray<qreal,128> StrokeAnalyzer::direction(
+    const StrokeView &points, bool derivative)
+{
+    QVarLengthArray<qreal,128> angles;
+
+    QPointF p0 = (points.count() > 0 ? points.first() : QPointF(0.0, 0.0));
+    qreal angle0 = 0.0;
+    qreal len0 = 1.0;
+    for (int i = 1; i < points.count(); ++i) {
+        QPointF p1(points.at(i));
+        QPointF df = p1 - p0;
+        qreal len = qSqrt(df.x() * df.x() + df.y() * df.y());
+        qreal sinA = df.y() / len;
+
+        qreal angle1 = qAsin(sinA); /* [-M_PI/2 ; M_PI/2] */
+        if (df.x() < 0) {
+            angle1 = M_PI - angle1; /* [-M_PI/2 ; 3*M_PI/2] */
+        }
+        if (angle1 - angle0 > M_PI) {
+            angle1 = angle1 - 2 * M_PI;
+        } else if(angle0 - angle1 > M_PI) {
+            angle1 = angle1 + 2 * M_PI;
+        }
+
+        if (derivative) {
+            qreal da = angle1 - angle0; /* [-2*M_PI ; 2*M_PI] */
+            if (da > M_PI)
+                da -= M_PI;             /* [-2*M_PI ;   M_PI] */
+            else if (da < -M_PI)
+                da += M_PI;             /* [  -M_PI ;   M_PI] */
+
+            da /= 0.5 * (len + len0);
+            angles << da;
+        } else {
+            angles << angle1;
+        }
+
+        p0 = p1;
+        angle0 = angle1;
+        len0 = len;
+    }
+    return angles;
+}
+
+QVarLengthArray<qreal,128> StrokeAnalyzer::length(const StrokeView &points)
+{
+    QVarLengthArray<qreal,128> lengths;
+
+    if (points.count() > 1) {
+        QPointF prev = points.at(0);
+        for (int i = 1; i < points.count(); ++i) {
+            QPointF curr = points.at(i);
+            QPointF vector = curr - prev;
+            lengths << qSqrt(vector.x() * vector.x() + vector.y() * vector.y());
+            prev = curr;
+        }
+    }
+
+    return lengths;
+}
+
+PointArray<256> StrokeAnalyzer::derivative(const StrokeView &points)
+{
+    PointArray<256> dpoints;
+
+    if (points.count() > 1) {
+        QPointF prev = points.at(0);
+        for (int i = 1; i < points.count(); ++i) {
+            QPointF curr = points.at(i);
+            dpoints << (curr - prev);
+            prev = curr;
+        }
+    }
+
+    return dpoints;
+}
+
+QVarLengthArray<int,128> StrokeAnalyzer::detectOutliers(
+    const QVarLengthArray<qreal,128> &values, qreal multiplier, int tinySegment)
+{
+    TRACE_SCOPE("detectOutliers");
+    int cnt = values.count();
+
+    qreal mean = 0;
+    foreach (qreal value, values)
+        mean += value / cnt;
+
+    qreal stddev = 0;
+    foreach (qreal value, values)
+        stddev += (value - mean) * (value - mean) / (cnt - 1);
+    stddev = qSqrt(stddev);
+
+    QVarLengthArray<int,128> outliers;
+    outliers << -1;
+    for (int i = 0; i < values.count(); ++i) {
+        if (qAbs(values.at(i) - mean) > multiplier * stddev) {
+            if (i - outliers.at(outliers.count() - 1) > tinySegment)
+                outliers << i;
+        }
+    }
+
+    if ((values.count() - 1) - outliers.at(outliers.count() - 1) < tinySegment)
+        outliers.remove(outliers.count() - 1);
+    outliers << values.count() - 1;
+
+    return outliers;
+}
+
+/* Squared length of derivative of derivative of derivative at i, point i
+ * is (px[i * step], py[i * step]). Step is Stride, unless it is 0, then
+ * stride given at runtime */
+template <int Stride>
+static inline qreal squaredThirdDifference(const qreal *px, const qreal *py,
+    int stride, int i)
+{
+    const int step = Stride ? Stride : stride;
+    const qreal *x = px + step * i;
+    const qreal *y = py + step * i;
+    qreal dx = ((x[3 * step] - x[2 * step]) - (x[2 * step] - x[step])) -
+        ((x[2 * step] - x[step]) - (x[step] - x[0]));
+    qreal dy = ((y[3 * step] - y[2 * step]) - (y[2 * step] - y[step])) -
+        ((y[2 * step] - y[step]) - (y[step] - y[0]));
+    return dx * dx + dy * dy;
+}
+
+template <int Stride>
+static inline qreal thirdDifference(const qreal *px, const qreal *py,
+    int stride, int i)
+{
+    return qSqrt(squaredThirdDifference<Stride>(px, py, stride, i));
+}
+
+/* Adds third difference lengths minus shift for i in [begin, end) */
+template <int Stride>
+static void sums(const qreal *px, const qreal *py, int stride, int begin,
+    int end, qreal shift, qreal *sum, qreal *sum2)
+{
+    for (int i = begin; i < end; ++i) {
+        qreal value = thirdDifference<Stride>(px, py, stride, i) - shift;
+        *sum += value;
+        *sum2 += value * value;
+    }
+}
+
+/* First i in [begin, end) with squared third difference length outside
+ * of [lower2, upper2], end if there is none */
+template <int Stride>
+static int nextOutlier(const qreal *px, const qreal *py, int stride,
+    int begin, int end, qreal upper2, qreal lower2)
+{
+    for (int i = begin; i < end; ++i) {
+        qreal value2 = squaredThirdDifference<Stride>(px, py, stride, i);
+        if (value2 > upper2 || value2 < lower2)
+            return i;
+    }
+    return end;
+}
+
+#ifdef STROKE_X86
+
+static bool hasAvx()
+{
+    /* Detected once, initialization of local statics is thread-safe */
+    static const bool avx = __builtin_cpu_supports("avx");
+    return avx;
+}
+
+/* Squared third difference lengths at i, ..., i + 3, same operation
+ * order as squaredThirdDifference */
+__attribute__((target("avx")))
+static inline __m256d squaredThirdDifferenceAvx(const qreal *x,
+    const qreal *y, int i)
+{
+    __m256d x0 = _mm256_loadu_pd(x + i);
+    __m256d x1 = _mm256_loadu_pd(x + i + 1);
+    __m256d x2 = _mm256_loadu_pd(x + i + 2);
+    __m256d x3 = _mm256_loadu_pd(x + i + 3);
+    __m256d y0 = _mm256_loadu_pd(y + i);
+    __m256d y1 = _mm256_loadu_pd(y + i + 1);
+    __m256d y2 = _mm256_loadu_pd(y + i + 2);
+    __m256d y3 = _mm256_loadu_pd(y + i + 3);
+    __m256d dx21 = _mm256_sub_pd(x2, x1);
+    __m256d dy21 = _mm256_sub_pd(y2, y1);
+    __m256d dx = _mm256_sub_pd(
+        _mm256_sub_pd(_mm256_sub_pd(x3, x2), dx21),
+        _mm256_sub_pd(dx21, _mm256_sub_pd(x1, x0)));
+    __m256d dy = _mm256_sub_pd(
+        _mm256_sub_pd(_mm256_sub_pd(y3, y2), dy21),
+        _mm256_sub_pd(dy21, _mm256_sub_pd(y1, y0)));
+    return _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+}
+
+__attribute__((target("avx")))
+static void sumsAvx(const qreal *x, const qreal *y, int end, qreal shift,
+    qreal *sum, qreal *sum2)
+{
+    __m256d vshift = _mm256_set1_pd(shift);
+    __m256d vsum = _mm256_setzero_pd();
+    __m256d vsum2 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= end; i += 4) {
+        __m256d value = _mm256_sub_pd(
+            _mm256_sqrt_pd(squaredThirdDifferenceAvx(x, y, i)), vshift);
+        vsum = _mm256_add_pd(vsum, value);
+        vsum2 = _mm256_add_pd(vsum2, _mm256_mul_pd(value, value));
+    }
+
+    qreal lanes[4], lanes2[4];
+    _mm256_storeu_pd(lanes, vsum);
+    _mm256_storeu_pd(lanes2, vsum2);
+    *sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    *sum2 += (lanes2[0] + lanes2[1]) + (lanes2[2] + lanes2[3]);
+    sums<1>(x, y, 1, i, end, shift, sum, sum2);
+}
+
+__attribute__((target("avx")))
+static int nextOutlierAvx(const qreal *x, const qreal *y, int begin, int end,
+    qreal upper2, qreal lower2)
+{
+    __m256d vupper2 = _mm256_set1_pd(upper2);
+    __m256d vlower2 = _mm256_set1_pd(lower2);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d value2 = squaredThirdDifferenceAvx(x, y, i);
+        int mask = _mm256_movemask_pd(_mm256_or_pd(
+            _mm256_cmp_pd(value2, vupper2, _CMP_GT_OQ),
+            _mm256_cmp_pd(value2, vlower2, _CMP_LT_OQ)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return nextOutlier<1>(x, y, 1, i, end, upper2, lower2);
+}
+
+#endif
+
+/* Stride is a constant for common layouts, so that separate x and y
+ * arrays get contiguous loads, which vector kernels take when CPU
+ * supports them */
+template <int Stride>
+static QVarLengthArray<int,128> findOutliers(const qreal *px, const qreal *py,
+    int stride, int num, qreal multiplier, int tinySegment)
+{
+    int cnt = qMax(num - 3, 0);
+#ifdef STROKE_X86
+    bool avx = Stride == 1 && hasAvx();
+#endif
+
+    /* Mean and variance from sums shifted by the first value, which keeps
+     * them accurate without division in the loop, as Welford would have */
+    qreal shift = cnt > 0 ? thirdDifference<Stride>(px, py, stride, 0) : 0;
+    qreal sum = 0;
+    qreal sum2 = 0;
+#ifdef STROKE_X86
+    if (avx)
+        sumsAvx(px, py, cnt, shift, &sum, &sum2);
+    else
+#endif
+        sums<Stride>(px, py, stride, 0, cnt, shift, &sum, &sum2);
+    qreal mean = cnt > 0 ? shift + sum / cnt : 0;
+    qreal stddev = cnt > 1 ?
+        qSqrt(qMax((sum2 - sum * sum / cnt) / (cnt - 1), qreal(0))) : 0;
+
+    /* Values are recomputed in the second sweep, which is cheaper than
+     * storing them once strokes outgrow preallocated arrays. Squared
+     * lengths are compared against squared bounds to skip square roots */
+    qreal upper = mean + multiplier * stddev;
+    qreal lower = mean - multiplier * stddev;
+    qreal upper2 = upper * upper;
+    qreal lower2 = lower > 0 ? lower * lower : -1;
+
+    QVarLengthArray<int,128> outliers;
+    outliers << -1;
+    for (int i = tinySegment; i < cnt; i += tinySegment + 1) {
+#ifdef STROKE_X86
+        if (avx)
+            i = nextOutlierAvx(px, py, i, cnt, upper2, lower2);
+        else
+#endif
+            i = nextOutlier<Stride>(px, py, stride, i, cnt, upper2, lower2);
+        if (i < cnt)
+            outliers << i;
+    }
+
+    if ((cnt - 1) - outliers.at(outliers.count() - 1) < tinySegment)
+        outliers.remove(outliers.count() - 1);
+    outliers << cnt - 1;
+
+    return outliers;
+}
+
+/* Turns outliers of third differences of num points into breakpoints */
+static QVarLengthArray<int,128> toBreakpoints(
+    QVarLengthArray<int,128> outliers, int num)
+{
+    /* Stroke too short for statistics is a single segment */
+    if (outliers.count() < 2 || outliers.at(0) != -1) {
+        outliers.clear();
+        outliers << -1 << num - 2;
+        return outliers;
+    }
+
+    /* Compensate double derivation */
+    for (int i = 1; i < outliers.count(); ++i) {
+        outliers[i] += 2;
+    }
+
+    return outliers;
+}
+
+template <class Points>
+static QVector<Points> splitSegments(const Points &points,
+    const QVarLengthArray<int,128> &breakpoints)
+{
+    QVector<Points> segments;
+    Points segment;
+    int k = 1;
+    for (int i = 0; i < points.count() && k < breakpoints.count(); ++i) {
+        segment << points.at(i);
+
+        /* End of segment reached */
+        if (breakpoints[k] + 1 == i) {
+            segments << segment;
+
+            k++;
+            segment.clear();
+            segment << points.at(i);
+        }
+    }
+
+    return segments;
+}
+
+QVarLengthArray<int,128> StrokeAnalyzer::outliers(const StrokeView &points,
+    qreal multiplier, int tinySegment)
+{
+    TRACE_SCOPE("outliers");
+    const qreal *x = points.xData();
+    const qreal *y = points.yData();
+    switch (points.stride()) {
+    case 1:
+        return findOutliers<1>(x, y, 1, points.count(), multiplier,
+            tinySegment);
+    case 2:
+        return findOutliers<2>(x, y, 2, points.count(), multiplier,
+            tinySegment);
+    default:
+        return findOutliers<0>(x, y, points.stride(), points.count(),
+            multiplier, tinySegment);
+    }
+}
+
+QVarLengthArray<int,128> StrokeAnalyzer::breakpoints(const StrokeView &points,
+    qreal multiplier, int tinySegment)
+{
+    TRACE_SCOPE("breakpoints");
+    return toBreakpoints(
+        StrokeAnalyzer::outliers(points, multiplier, tinySegment),
+        points.count());
+}
+
+QVector<PointArray<256> > StrokeAnalyzer::segments(const PointArray<256> &points,
+    const QVarLengthArray<int,128> &breakpoints)
+{
+    TRACE_SCOPE("segments");
+    return splitSegments(points, breakpoints);
+}
+
+QVector<PointArraySoA<256> > StrokeAnalyzer::segments(
+    const PointArraySoA<256> &points, const QVarLengthArray<int,128> &breakpoints)
+{
+    TRACE_SCOPE("segments");
+    return splitSegments(points, breakpoints);
+}
+
+QVector<StrokeView> StrokeAnalyzer::segmentViews(const StrokeView &points,
+    const QVarLengthArray<int,128> &breakpoints)
+{
+    QVector<StrokeView> segments;
+    /* Same segments as segments() above, which end at breakpoint + 1.
+     * Ends behind the scan position are never reached there either */
+    int begin = 0;
+    int next = 0;
+    for (int k = 1; k < breakpoints.count(); ++k) {
+        int end = breakpoints[k] + 1;
+        if (end < next || end >= points.count())
+            break;
+        segments << points.mid(begin, end - begin + 1);
+        begin = end;
+        next = end + 1;
+    }
+
+    return segments;
+}
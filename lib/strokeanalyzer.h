@@ -0,0 +1,70 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef STROKEANALYZER_H
+#define STROKEANALYZER_H
+
+#include <QVarLengthArray>
+#include <QVector>
+
+#include "pointarray.h"
+#include "pointarraysoa.h"
+#include "strokeview.h"
+
+/* Outlier is that many standard deviations away from mean */
+#define OUTLIER_MULTIPLIER 1.5
+/* Outliers closer than that to previous one or to stroke end are ignored */
+#define TINY_SEGMENT 4
+
+/* Splits stroke into segments at corners, which are detected as outliers
+ * of second derivative length. Needs QtCore only. */
+class StrokeAnalyzer
+{
+public:
+    static QVarLengthArray<qreal,128> direction(const StrokeView &points,
+        bool derivative);
+
+    static QVarLengthArray<qreal,128> length(const StrokeView &points);
+    static PointArray<256> derivative(const StrokeView &points);
+
+    static QVarLengthArray<int,128> detectOutliers(
+        const QVarLengthArray<qreal,128> &values, qreal multiplier,
+        int tinySegment = TINY_SEGMENT);
+
+    /* detectOutliers(length(derivative(derivative(points)))) fused into
+     * two sweeps over points without intermediate arrays */
+    static QVarLengthArray<int,128> outliers(const StrokeView &points,
+        qreal multiplier, int tinySegment = TINY_SEGMENT);
+
+    /* Segment ends as point indices minus one, starting with -1 */
+    static QVarLengthArray<int,128> breakpoints(const StrokeView &points,
+        qreal multiplier = OUTLIER_MULTIPLIER,
+        int tinySegment = TINY_SEGMENT);
+    /* Adjacent segments share their end point */
+    static QVector<PointArray<256> > segments(const PointArray<256> &points,
+        const QVarLengthArray<int,128> &breakpoints);
+    static QVector<PointArraySoA<256> > segments(
+        const PointArraySoA<256> &points,
+        const QVarLengthArray<int,128> &breakpoints);
+    /* Same segments as views into points, without copying */
+    static QVector<StrokeView> segmentViews(const StrokeView &points,
+        const QVarLengthArray<int,128> &breakpoints);
+};
+
+#endif // STROKEANALYZER_H
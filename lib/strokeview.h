@@ -0,0 +1,81 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef STROKE_VIEW_H
+#define STROKE_VIEW_H
+
+#include <QPointF>
+
+#include "pointarray.h"
+#include "pointarraysoa.h"
+
+/* Non-owning read-only view of count points, point i is
+ * (x[i * stride], y[i * stride]). Interleaved points have stride 2,
+ * separate x and y arrays stride 1. Points must outlive the view. */
+class StrokeView
+{
+public:
+    inline StrokeView() : m_x(0), m_y(0), m_count(0), m_stride(2) {};
+    /* Interleaved x0, y0, x1, y1, ... */
+    inline StrokeView(const qreal *xy, int count) :
+        m_x(xy), m_y(xy + 1), m_count(count), m_stride(2) {};
+    inline StrokeView(const qreal *x, const qreal *y, int count,
+        int stride = 1) :
+        m_x(x), m_y(y), m_count(count), m_stride(stride) {};
+    /* QPointF is a pair of qreals, so arrays of them, such as data of
+     * QPolygonF or std::vector<QPointF>, are interleaved points */
+    inline StrokeView(const QPointF *points, int count) :
+        m_x(reinterpret_cast<const qreal*>(points)),
+        m_y(reinterpret_cast<const qreal*>(points) + 1),
+        m_count(count), m_stride(2) {};
+    template <int Prealloc>
+    inline StrokeView(const PointArray<Prealloc> &points) :
+        m_x(points.constData()), m_y(points.constData() + 1),
+        m_count(points.count()), m_stride(2) {};
+    template <int Prealloc>
+    inline StrokeView(const PointArraySoA<Prealloc> &points) :
+        m_x(points.xData()), m_y(points.yData()),
+        m_count(points.count()), m_stride(1) {};
+
+    inline QPointF at(int i) const { return QPointF(x(i), y(i)); };
+    inline QPointF first(void) const { return at(0); };
+    inline QPointF last(void) const  { return at(m_count - 1); };
+    inline qreal x(int i) const { return m_x[i * m_stride]; };
+    inline qreal y(int i) const { return m_y[i * m_stride]; };
+
+    inline const qreal *xData(void) const { return m_x; };
+    inline const qreal *yData(void) const { return m_y; };
+    inline int stride(void) const { return m_stride; };
+    inline int count(void) const { return m_count; };
+    inline bool isEmpty(void) const { return m_count == 0; };
+
+    /* View of count points starting at point begin, without copying */
+    inline StrokeView mid(int begin, int count) const {
+        return StrokeView(m_x + begin * m_stride, m_y + begin * m_stride,
+            count, m_stride);
+    };
+
+private:
+    const qreal *m_x;
+    const qreal *m_y;
+    int m_count;
+    int m_stride;
+};
+
+#endif // STROKE_VIEW_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "tracer.h"
+
+#ifdef CURVES_TRACE
+
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+#include <algorithm>
+
+#define TRACE_FILE "curves-trace.json"
+
+Tracer *Tracer::instance()
+{
+    static Tracer tracer;
+    return &tracer;
+}
+
+Tracer::Tracer()
+{
+    m_timer.start();
+}
+
+Tracer::~Tracer()
+{
+    QByteArray fileName = qgetenv("CURVES_TRACE_FILE");
+    save(fileName.isEmpty() ? QString(TRACE_FILE) : QString::fromLocal8Bit(fileName));
+    summary();
+}
+
+qreal Tracer::now() const
+{
+    return m_timer.nsecsElapsed() * 1e-3;
+}
+
+void Tracer::complete(const char *name, qreal start, qreal duration)
+{
+    QMutexLocker locker(&m_mutex);
+    Qt::HANDLE id = QThread::currentThreadId();
+    QHash<Qt::HANDLE, int>::const_iterator it = m_threads.constFind(id);
+    if (it == m_threads.constEnd())
+        it = m_threads.insert(id, m_threads.count() + 1);
+
+    Event event = { name, start, duration, it.value() };
+    m_events << event;
+}
+
+bool Tracer::save(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text |
+            QIODevice::Truncate)) {
+        qCritical() << "Cannot open" << fileName << "for writing";
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setRealNumberPrecision(3);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (int i = 0; i < m_events.count(); ++i) {
+        const Event &event = m_events.at(i);
+        out << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << event.name << "\",\"cat\":\"curves\""
+            << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+            << "}";
+    }
+    out << "\n]}\n";
+    return true;
+}
+
+/* Logs p50 and p99 of each stage, viewers show the same per slice.
+ * Goes through qWarning, which QT_NO_DEBUG_OUTPUT does not silence */
+void Tracer::summary() const
+{
+    QMutexLocker locker(&m_mutex);
+    QMap<QString, QVector<qreal> > durations;
+    foreach (const Event &event, m_events)
+        durations[QString(event.name)] << event.duration;
+
+    QMap<QString, QVector<qreal> >::iterator it;
+    for (it = durations.begin(); it != durations.end(); ++it) {
+        QVector<qreal> &values = it.value();
+        std::sort(values.begin(), values.end());
+        int count = values.count();
+        qWarning("%s count %d p50 %.3f us p99 %.3f us",
+            qPrintable(it.key()), count, values.at((count - 1) / 2),
+            values.at((count - 1) * 99 / 100));
+    }
+}
+
+#endif // CURVES_TRACE
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2012 Daniil Ivanov <daniil.ivanov@gmail.com>
+ *
+ * This file is part of Curves.
+ *
+ * Curves is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Curves is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with Curves. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+/* Stage timing in Chrome trace event format, viewable in
+ * chrome://tracing or ui.perfetto.dev. Built with qmake CONFIG+=trace,
+ * otherwise TRACE_* macros expand to nothing. Trace is written at exit
+ * to file named by CURVES_TRACE_FILE, curves-trace.json by default. */
+
+#ifdef CURVES_TRACE
+
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+class Tracer
+{
+public:
+    static Tracer *instance();
+
+    /* Microseconds since tracer start */
+    qreal now() const;
+
+    /* Records stage which started at start and lasted duration */
+    void complete(const char *name, qreal start, qreal duration);
+
+    bool save(const QString &fileName);
+
+private:
+    Tracer();
+    ~Tracer();
+
+    struct Event
+    {
+        const char *name;
+        qreal start;
+        qreal duration;
+        int thread;
+    };
+
+    void summary() const;
+
+    QElapsedTimer m_timer;
+    mutable QMutex m_mutex;
+    QVector<Event> m_events;
+    QHash<Qt::HANDLE, int> m_threads;
+};
+
+/* Records lifetime of the enclosing scope as stage */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) :
+        m_name(name), m_start(Tracer::instance()->now()) {}
+    ~TraceScope() {
+        Tracer *tracer = Tracer::instance();
+        tracer->complete(m_name, m_start, tracer->now() - m_start);
+    }
+
+private:
+    const char *m_name;
+    qreal m_start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_NOW() (Tracer::instance()->now())
+#define TRACE_SINCE(name, start) \
+    Tracer::instance()->complete(name, start, TRACE_NOW() - (start))
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_NOW() 0
+#define TRACE_SINCE(name, start)
+
+#endif // CURVES_TRACE
+
+#endif // TRACER_H
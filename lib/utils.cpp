@@ -21,7 +21,7 @@
 
 #include "utils.h"
 
-void Utils::saveToFile(const QString &fileName, const PointArray<256> &points,
+void Utils::saveToFile(const QString &fileName, const StrokeView &points,
     bool append)
 {
     QFile file(fileName);
@@ -33,12 +33,12 @@ void Utils::saveToFile(const QString &fileName, const PointArray<256> &points,
 
     QTextStream in(&file);
     for (int i = 0; i < points.count() - 1; ++i)
-        in << points.at(i).x() << ",";
-    in << points.last().x() << "\n";
+        in << points.x(i) << ",";
+    in << points.x(points.count() - 1) << "\n";
 
     for (int i = 0; i < points.count() - 1; ++i)
-        in << points.at(i).y() << ",";
-    in << points.last().y() << "\n";
+        in << points.y(i) << ",";
+    in << points.y(points.count() - 1) << "\n";
 
     file.close();
 }
@@ -23,7 +23,7 @@
 #include <QFile>
 #include <QTextStream>
 
-#include "pointarray.h"
+#include "strokeview.h"
 
 class Utils
 {
@@ -47,8 +47,8 @@ public:
         file.close();
     }
 
-    static void saveToFile(const QString &fileName,
-        const PointArray<256> &points, bool append);
+    static void saveToFile(const QString &fileName, const StrokeView &points,
+        bool append);
 };
 
 #endif // UTILS_H
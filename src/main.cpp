@@ -26,6 +26,12 @@ int main(int argc, char **argv)
     QApplication a(argc, argv);
 
     Pane pane;
+    /* Fit whole stroke on mouse release, as before incremental mode */
+    if (a.arguments().contains("--on-release"))
+        pane.setIncremental(false);
+    /* Split long segments into several curves where one does not fit */
+    if (a.arguments().contains("--piecewise"))
+        pane.setPiecewise(true);
     pane.show();
 
     return a.exec();
@@ -24,20 +24,34 @@
 #include <QGraphicsScene>
 #include <QGraphicsLineItem>
 #include <QGraphicsSceneMouseEvent>
-#include <QDebug>
 
 #include "pane.h"
 #include "curvefitter.h"
+#include "piecewisefitter.h"
+#include "tracer.h"
+
+/* Part of 60 Hz frame an open segment refit may take, ns */
+#define PREVIEW_BUDGET 8000000
+/* Final fit of a segment closed while drawing takes at most a frame, ns */
+#define CLOSE_BUDGET 16000000
 
 Pane::Pane(QWidget *parent)
     : QGraphicsView(parent),
     m_scene(new QGraphicsScene(this)),
     m_active(true),
-    tolerance(2.0)
+    tolerance(2.0),
+    m_incremental(true)
+#ifdef CURVES_TRACE
+    , m_releaseTime(0),
+    m_paintPending(false)
+#endif
 {
     m_scene->setBackgroundBrush(Qt::black);
     m_scene->installEventFilter(this);
 
+    m_incrementalFitter.setPreviewBudget(PREVIEW_BUDGET);
+    m_incrementalFitter.setCloseBudget(CLOSE_BUDGET);
+
     setRenderHints(renderHints() | QPainter::Antialiasing);
     setWindowState(windowState() ^ Qt::WindowMaximized);
     setFrameShape(QFrame::NoFrame);
@@ -56,6 +70,20 @@ Pane::~Pane()
     m_file->close();
 }
 
+void Pane::setIncremental(bool incremental)
+{
+    m_incremental = incremental;
+    /* Previews are drawn only while stroke is, fit on release runs to
+     * convergence */
+    m_incrementalFitter.setPreviewBudget(incremental ? PREVIEW_BUDGET : 0);
+    m_incrementalFitter.setCloseBudget(incremental ? CLOSE_BUDGET : 0);
+}
+
+void Pane::setPiecewise(bool piecewise)
+{
+    m_incrementalFitter.setPiecewise(piecewise);
+}
+
 bool Pane::eventFilter(QObject *obj, QEvent *event)
 {
     switch (event->type()) {
@@ -74,6 +102,9 @@ bool Pane::eventFilter(QObject *obj, QEvent *event)
                 m_scene->removeItem(item);
                 delete item;
             }
+            m_incrementalFitter.reset();
+            m_segmentItems.clear();
+            m_openItems.clear();
             m_active = true;
         }
         QGraphicsSceneMouseEvent *mouseEvent =
@@ -87,6 +118,8 @@ bool Pane::eventFilter(QObject *obj, QEvent *event)
               << QDateTime::currentMSecsSinceEpoch() << "\n";
 
         m_points << point;
+        if (m_incremental)
+            updateFit(point);
     }
         break;
     case QEvent::GraphicsSceneMouseMove: {
@@ -106,13 +139,23 @@ bool Pane::eventFilter(QObject *obj, QEvent *event)
                 tolerance * tolerance) {
             addLine(m_points.last(), point, Qt::yellow);
             m_points << point;
+            if (m_incremental)
+                updateFit(point);
         }
     }
         break;
     case QEvent::GraphicsSceneMouseRelease: {
-        /* Proceed with analysis */
+        TRACE_SCOPE("mouseRelease");
+#ifdef CURVES_TRACE
+        m_releaseTime = TRACE_NOW();
+        m_paintPending = true;
+#endif
+        /* Proceed with analysis, unless it was done while drawing */
         m_active = false;
-        analyse();
+        if (m_incremental)
+            finishFit();
+        else
+            analyse();
     }
         break;
     default:
@@ -122,170 +165,125 @@ bool Pane::eventFilter(QObject *obj, QEvent *event)
     return QObject::eventFilter(obj, event);
 }
 
-QVarLengthArray<qreal,128> Pane::direction(const PointArray<256> &points, bool derivative)
+#ifdef CURVES_TRACE
+void Pane::paintEvent(QPaintEvent *event)
 {
-    QVarLengthArray<qreal,128> angles;
-
-    QPointF p0 = (points.count() > 0 ? points.first() : QPointF(0.0, 0.0));
-    qreal angle0 = 0.0;
-    qreal len0 = 1.0;
-    for (int i = 1; i < points.count(); ++i) {
-        QPointF p1(points.at(i));
-        QPointF df = p1 - p0;
-        qreal len = qSqrt(df.x() * df.x() + df.y() * df.y());
-        qreal sinA = df.y() / len;
-
-        qreal angle1 = qAsin(sinA); /* [-M_PI/2 ; M_PI/2] */
-        if (df.x() < 0) {
-            angle1 = M_PI - angle1; /* [-M_PI/2 ; 3*M_PI/2] */
-        }
-        if (angle1 - angle0 > M_PI) {
-            angle1 = angle1 - 2 * M_PI;
-        } else if(angle0 - angle1 > M_PI) {
-            angle1 = angle1 + 2 * M_PI;
-        }
-
-        if (derivative) {
-            qreal da = angle1 - angle0; /* [-2*M_PI ; 2*M_PI] */
-            if (da > M_PI)
-                da -= M_PI;             /* [-2*M_PI ;   M_PI] */
-            else if (da < -M_PI)
-                da += M_PI;             /* [  -M_PI ;   M_PI] */
-
-            da /= 0.5 * (len + len0);
-            angles << da;
-        } else {
-            angles << angle1;
-        }
-
-        p0 = p1;
-        angle0 = angle1;
-        len0 = len;
+    {
+        TRACE_SCOPE("paint");
+        QGraphicsView::paintEvent(event);
+    }
+    /* First paint after release shows analysis result */
+    if (m_paintPending) {
+        m_paintPending = false;
+        TRACE_SINCE("releaseToPaint", m_releaseTime);
     }
-    return angles;
 }
+#endif
 
-QVarLengthArray<qreal,128> Pane::length(const PointArray<256> &points)
+QGraphicsItem *Pane::addEllipse(const QPointF &point, const QColor &color)
 {
-    QVarLengthArray<qreal,128> lengths;
-
-    if (points.count() > 1) {
-        QPointF prev = points.at(0);
-        for (int i = 1; i < points.count(); ++i) {
-            QPointF curr = points.at(i);
-            QPointF vector = curr - prev;
-            lengths << qSqrt(vector.x() * vector.x() + vector.y() * vector.y());
-            prev = curr;
-        }
-    }
-
-    return lengths;
+    QGraphicsEllipseItem *ellipse =
+        new QGraphicsEllipseItem(point.x() - 3.0, point.y() - 3.0, 6, 6);
+    ellipse->setPen(QPen(color));
+    m_scene->addItem(ellipse);
+    return ellipse;
 }
 
-PointArray<256> Pane::derivative(const PointArray<256> &points)
+QGraphicsItem *Pane::addLine(const QPointF &point0, const QPointF &point1,
+    const QColor &color)
 {
-    PointArray<256> dpoints;
-
-    if (points.count() > 1) {
-        QPointF prev = points.at(0);
-        for (int i = 1; i < points.count(); ++i) {
-            QPointF curr = points.at(i);
-            dpoints << (curr - prev);
-            prev = curr;
-        }
-    }
-
-    return dpoints;
+    QLineF line(point0, point1);
+    return m_scene->addLine(line, QPen(color));
 }
 
-QVarLengthArray<int,128> Pane::detectOutliers(const QVarLengthArray<qreal,128> &values,
-    qreal multiplier, int tinySegment)
+/* Draws control polygon, count samples of curve and inner control points */
+void Pane::drawCurve(const PointArray<256> &curve, int count,
+    QList<QGraphicsItem*> *items)
 {
-    int cnt = values.count();
-
-    qreal mean = 0;
-    foreach (qreal value, values)
-        mean += value / cnt;
-
-    qreal stddev = 0;
-    foreach (qreal value, values)
-        stddev += (value - mean) * (value - mean) / (cnt - 1);
-    stddev = qSqrt(stddev);
+    TRACE_SCOPE("draw");
+    QList<QGraphicsItem*> added;
+    for (int j = 0; j < curve.count(); j += 2) {
+        added << addLine(curve.at(j), curve.at(j + 1), Qt::blue);
+    }
 
-    QVarLengthArray<int,128> outliers;
-    outliers << -1;
-    for (int i = 0; i < values.count(); ++i) {
-        if (qAbs(values.at(i) - mean) > multiplier * stddev) {
-            if (i - outliers.at(outliers.count() - 1) > tinySegment)
-                outliers << i;
-        }
+    PointArray<256> points = m_fitter.curve(curve, count);
+    for (int j = 0; j < points.count() - 1; ++j) {
+        added << addLine(points.at(j), points.at(j + 1), Qt::white);
     }
 
-    if ((values.count() - 1) - outliers.at(outliers.count() - 1) < tinySegment)
-        outliers.remove(outliers.count() - 1);
-    outliers << values.count() - 1;
+    for (int j = 1; j < curve.count() - 1; ++j) {
+        added << addEllipse(curve.at(j), Qt::red);
+    }
 
-    return outliers;
+    if (items)
+        *items << added;
 }
 
-void Pane::addEllipse(const QPointF &point, const QColor &color)
+void Pane::analyse()
 {
-    QGraphicsEllipseItem *ellipse =
-        new QGraphicsEllipseItem(point.x() - 3.0, point.y() - 3.0, 6, 6);
-    ellipse->setPen(QPen(color));
-    m_scene->addItem(ellipse);
+    TRACE_SCOPE("analyse");
+    /* Whole stroke gets the same segments and fits incremental mode ends
+     * up with */
+    m_incrementalFitter.fit(m_points);
+    drawSegments(0);
 }
 
-void Pane::addLine(const QPointF &point0, const QPointF &point1, const QColor &color)
+void Pane::updateFit(const QPointF &point)
 {
-    QLineF line(point0, point1);
-    m_scene->addLine(line, QPen(color));
+    TRACE_SCOPE("updateFit");
+    if (m_incrementalFitter.addPoint(point))
+        drawSegment(m_incrementalFitter.segments().last(), true);
+
+    /* Preview of open segment replaces the previous one */
+    const PointArray<256> &preview = m_incrementalFitter.preview();
+    if (preview.isEmpty())
+        return;
+    removeItems(m_openItems);
+    drawCurve(preview, m_points.count() - m_incrementalFitter.openBegin(),
+        &m_openItems);
 }
 
-void Pane::analyse()
+void Pane::finishFit()
 {
-    PointArray<256> points1 = derivative(m_points);
-    PointArray<256> points2 = derivative(points1);
-    QVarLengthArray<qreal,128> stats = length(points2);
-    QVarLengthArray<int,128> outliers = detectOutliers(stats, 1.5);
-
-    /* Compensate double derivation */
-    for (int i = 1; i < outliers.count(); ++i) {
-        outliers[i] += 2;
+    /* Stroke ends on segments of whole stroke, those closed at
+     * provisional corners which moved are drawn again */
+    int kept = m_incrementalFitter.finish();
+    removeItems(m_openItems);
+    while (m_segmentItems.count() > kept) {
+        removeItems(m_segmentItems.last());
+        m_segmentItems.removeLast();
     }
+    drawSegments(kept);
+}
 
-    CurveFitter fitter;
-    PointArray<256> segment;
-    int k = 1;
-    for (int i = 0; i < m_points.count(); ++i) {
-        segment << m_points.at(i);
-
-        /* End of segment reached */
-        if (outliers[k] + 1 == i) {
-            PointArray<256> curve;
-            fitter.fit(segment, curve, CurveFitter::AFFINE);
-
-            for (int j = 0; j < curve.count(); j += 2) {
-                addLine(curve.at(j), curve.at(j + 1), Qt::blue);
-            }
-
-            PointArray<256> points = fitter.curve(curve, segment.count());
-            for (int j = 0; j < points.count() - 1; ++j) {
-                addLine(points.at(j), points.at(j + 1), Qt::white);
-            }
-
-            for (int j = 1; j < curve.count() - 1; ++j) {
-                addEllipse(curve.at(j), Qt::red);
-            }
+void Pane::drawSegments(int first)
+{
+    const QVector<IncrementalFitter::Segment> &segments =
+        m_incrementalFitter.segments();
+    for (int i = first; i < segments.count(); ++i)
+        drawSegment(segments.at(i), i < segments.count() - 1);
+}
 
-            k++;
-            segment.clear();
-            segment << m_points.at(i);
-        }
+void Pane::drawSegment(const IncrementalFitter::Segment &segment,
+    bool corner)
+{
+    removeItems(m_openItems);
+    QList<QGraphicsItem*> items;
+    for (int i = 0; i < PiecewiseFitter::pieceCount(segment.curve); ++i)
+        drawCurve(PiecewiseFitter::piece(segment.curve, i),
+            segment.knots[i + 1] - segment.knots[i] + 1, &items);
+    if (corner) {
+        TRACE_SCOPE("draw");
+        items << addEllipse(m_points.at(segment.end), Qt::red);
     }
+    m_segmentItems << items;
+}
 
-    foreach (int outlier, outliers) {
-        QPointF point = m_points.at(outlier + 1);
-        addEllipse(point, Qt::red);
+void Pane::removeItems(QList<QGraphicsItem*> &items)
+{
+    foreach (QGraphicsItem *item, items) {
+        m_scene->removeItem(item);
+        delete item;
     }
+    items.clear();
 }
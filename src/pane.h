@@ -22,12 +22,16 @@
 
 #include <QFile>
 #include <QGraphicsView>
+#include <QList>
 #include <QTextStream>
 #include <QVarLengthArray>
 
+#include "curvefitter.h"
+#include "incrementalfitter.h"
 #include "pointarray.h"
 
 class QPointF;
+class QGraphicsItem;
 class QGraphicsScene;
 
 class Pane : public QGraphicsView
@@ -38,22 +42,32 @@ public:
     Pane(QWidget *parent = 0);
     ~Pane();
 
+    /* Fit while stroke is drawn instead of on mouse release */
+    void setIncremental(bool incremental);
+    /* Fit segments with as many curves as they need instead of one */
+    void setPiecewise(bool piecewise);
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event);
+#ifdef CURVES_TRACE
+    void paintEvent(QPaintEvent *event);
+#endif
 
 private:
-    void addEllipse(const QPointF &point, const QColor &color);
-    void addLine(const QPointF &point0, const QPointF &point1, const QColor &color);
-
-    QVarLengthArray<qreal,128> direction(const PointArray<256> &points, bool derivative);
-
-    QVarLengthArray<qreal,128> length(const PointArray<256> &points);
-    PointArray<256> derivative(const PointArray<256> &points);
+    QGraphicsItem *addEllipse(const QPointF &point, const QColor &color);
+    QGraphicsItem *addLine(const QPointF &point0, const QPointF &point1,
+        const QColor &color);
+    void drawCurve(const PointArray<256> &curve, int count,
+        QList<QGraphicsItem*> *items = 0);
 
-    QVarLengthArray<int,128> detectOutliers(const QVarLengthArray<qreal,128> &outliers,
-        qreal multiplier, int tinySegment = 4);
     void analyse();
 
+    void updateFit(const QPointF &point);
+    void finishFit();
+    void drawSegments(int first);
+    void drawSegment(const IncrementalFitter::Segment &segment, bool corner);
+    void removeItems(QList<QGraphicsItem*> &items);
+
     QFile *m_file;
     QTextStream m_out;
     QGraphicsScene *m_scene;
@@ -61,6 +75,20 @@ private:
     QVarLengthArray<qreal,128> m_angles;
     bool m_active;
     const qreal tolerance;
+
+    CurveFitter m_fitter;
+    /* Fits strokes in either mode. Items show each segment, so that those
+     * closed at provisional corners may be drawn again, and preview of
+     * open segment in incremental mode */
+    bool m_incremental;
+    IncrementalFitter m_incrementalFitter;
+    QList<QList<QGraphicsItem*> > m_segmentItems;
+    QList<QGraphicsItem*> m_openItems;
+#ifdef CURVES_TRACE
+    /* Mouse release time, while analysis result is not painted yet */
+    qreal m_releaseTime;
+    bool m_paintPending;
+#endif
 };
 
 #endif // PANE_H
@@ -1,15 +1,10 @@
 QT += core gui
 TARGET = curves
 TEMPLATE = app
-CONFIG += debug
+CONFIG += debug c++14
+
+include(../lib/curvescore.pri)
 
 SOURCES += main.cpp
 HEADERS += pane.h
 SOURCES += pane.cpp
-HEADERS += curvefitter.h
-SOURCES += curvefitter.cpp
-HEADERS += pointarray.h
-HEADERS += utils.h
-SOURCES += utils.cpp
-
-LIBS += -lm -llevmar
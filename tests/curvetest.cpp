@@ -18,8 +18,16 @@
  */
 
 #include <QtTest>
+#include <QtConcurrentMap>
 
+#include "batchfitter.h"
+#include "beziereval.h"
+#include "bezierprojector.h"
+#include "cornerdetector.h"
 #include "curvetest.h"
+#include "incrementalfitter.h"
+#include "minimizer.h"
+#include "piecewisefitter.h"
 #include "utils.h"
 
 #define CURVE_LENGTH    80
@@ -27,6 +35,9 @@
 #define EPSILON         1e-4
 
 Q_DECLARE_METATYPE(CurveFitter::Transformation);
+Q_DECLARE_METATYPE(CurveFitter::Solver);
+Q_DECLARE_METATYPE(CurveFitter::Precision);
+Q_DECLARE_METATYPE(BezierEvaluator::Kernel);
 
 CurveTest::CurveTest(QObject *parent) : QObject(parent), m_fitter(0)
 {
@@ -41,14 +52,34 @@ void CurveTest::initTestCase()
 void CurveTest::testCurve_data()
 {
     QTest::addColumn<CurveFitter::Transformation>("transformation");
+    QTest::addColumn<CurveFitter::Solver>("solver");
+    QTest::addColumn<CurveFitter::Precision>("precision");
 
-    QTest::newRow("Euclidean") << CurveFitter::EUCLIDEAN;
-    QTest::newRow("Affine")     << CurveFitter::AFFINE;
+    QTest::newRow("Euclidean numeric") << CurveFitter::EUCLIDEAN
+        << CurveFitter::NUMERIC_LM << CurveFitter::DOUBLE;
+    QTest::newRow("Affine numeric") << CurveFitter::AFFINE
+        << CurveFitter::NUMERIC_LM << CurveFitter::DOUBLE;
+    QTest::newRow("Euclidean analytic") << CurveFitter::EUCLIDEAN
+        << CurveFitter::ANALYTIC_LM << CurveFitter::DOUBLE;
+    QTest::newRow("Affine analytic") << CurveFitter::AFFINE
+        << CurveFitter::ANALYTIC_LM << CurveFitter::DOUBLE;
+    QTest::newRow("Euclidean linear") << CurveFitter::EUCLIDEAN
+        << CurveFitter::LINEAR_LS << CurveFitter::DOUBLE;
+    QTest::newRow("Affine linear") << CurveFitter::AFFINE
+        << CurveFitter::LINEAR_LS << CurveFitter::DOUBLE;
+    QTest::newRow("Euclidean numeric single") << CurveFitter::EUCLIDEAN
+        << CurveFitter::NUMERIC_LM << CurveFitter::SINGLE;
+    QTest::newRow("Affine analytic single") << CurveFitter::AFFINE
+        << CurveFitter::ANALYTIC_LM << CurveFitter::SINGLE;
+    QTest::newRow("Affine linear single") << CurveFitter::AFFINE
+        << CurveFitter::LINEAR_LS << CurveFitter::SINGLE;
 }
 
 void CurveTest::testCurve()
 {
     QFETCH(CurveFitter::Transformation, transformation);
+    QFETCH(CurveFitter::Solver, solver);
+    QFETCH(CurveFitter::Precision, precision);
 
     /* Original Bezier curve */
     PointArray<256> curve;
@@ -61,8 +92,26 @@ void CurveTest::testCurve()
 
     /* Computed Bezier curve */
     PointArray<256> curve2;
-    qreal err = m_fitter->fit(points, curve2, transformation);
+    FitStats stats;
+    CurveFitter fitter;
+    fitter.setPrecision(precision);
+    QCOMPARE(fitter.precision(), precision);
+    qreal err = fitter.fit(points, curve2, transformation, solver, &stats);
     QVERIFY(err < EPSILON);
+
+    /* Stats describe the same fit */
+    QCOMPARE(stats.fits, 1);
+    QCOMPARE(stats.error, err);
+    QVERIFY(stats.outerIterations > 0);
+    QVERIFY(stats.iterations >= stats.outerIterations);
+    QVERIFY(stats.evaluations > 0);
+    int rounds = 0;
+    for (int i = 0; i < FitStats::TERMINATION_REASONS; ++i)
+        rounds += stats.terminations[i];
+    QCOMPARE(rounds, stats.outerIterations);
+    if (solver == CurveFitter::ANALYTIC_LM)
+        QVERIFY(stats.jacobians > 0);
+
     qreal stdCurve = 0;
     for (int i = 0; i < curve.count() && i < curve2.count(); ++i) {
         QPointF diff = curve.at(i) - curve2.at(i);
@@ -125,6 +174,47 @@ void CurveTest::testGoldenSectionSearch()
     QVERIFY((result - (-m_b / 2 * m_a)) < epsilon);
 }
 
+void CurveTest::testMinimizer()
+{
+    /* Parabolic steps hit minimum of a parabola at once */
+    int evaluations;
+    qreal fmin;
+    qreal x = Minimizer::brent([](qreal x) { return x * x + 2 * x + 3; },
+        -5.0, 5.0, 1e-8, &fmin, &evaluations);
+    QVERIFY(qAbs(x + 1.0) < 1e-8);
+    QVERIFY(qAbs(fmin - 2.0) < 1e-12);
+    QVERIFY(evaluations < 10);
+
+    /* Golden section steps still converge without smoothness */
+    x = Minimizer::brent([](qreal x) { return qAbs(x - 0.3); }, -1.0, 1.0,
+        1e-8);
+    QVERIFY(qAbs(x - 0.3) < 1e-8);
+
+    /* Batch finds the same minima as one problem at a time, smooth ones
+     * and kinked ones mixed */
+    const int num = 9;
+    qreal a[num], b[num], c[num], xmin[num];
+    for (int i = 0; i < num; ++i) {
+        c[i] = i * 0.37 - 1.0;
+        a[i] = c[i] - 1.0 - i * 0.1;
+        b[i] = c[i] + 0.5 + i * 0.2;
+    }
+    auto problem = [&c](int i, qreal u) {
+        return i % 2 ? qExp(u - c[i]) + qExp(c[i] - u) : qAbs(u - c[i]);
+    };
+    Minimizer::brent([&problem](const qreal *u, qreal *fu) {
+            for (int i = 0; i < num; ++i)
+                fu[i] = problem(i, u[i]);
+        }, num, a, b, 1e-8, xmin);
+    for (int i = 0; i < num; ++i) {
+        qreal single = Minimizer::brent([&problem, i](qreal u) {
+                return problem(i, u);
+            }, a[i], b[i], 1e-8);
+        QCOMPARE(xmin[i], single);
+        QVERIFY(qAbs(xmin[i] - c[i]) < 1e-6);
+    }
+}
+
 void CurveTest::testReparametrization()
 {
     /* Original Bezier curve */
@@ -136,10 +226,889 @@ void CurveTest::testReparametrization()
     qreal t = 0.5, newT = 0.6;
     m_fitter->point(curveData, t, xy);
 
-    m_fitter->reparametrizePoints(curveData, 1, xy, &newT);
+    m_fitter->reparametrizePoints<SPLINE_ORDER>(curveData, 1, xy, &newT);
     QVERIFY(t - newT < EPSILON);
 }
 
+static qreal distance(const QPointF &a, const QPointF &b)
+{
+    QPointF d = a - b;
+    return qSqrt(d.x() * d.x() + d.y() * d.y());
+}
+
+void CurveTest::testProjection()
+{
+    PointArray<256> controls;
+    controls << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+             << QPointF(1.25, -1.0) << QPointF(1.0, 0.0)
+             << QPointF(2.0, 0.5) << QPointF(1.5, 2.0);
+    QPointF points[] = { QPointF(0.5, 0.0), QPointF(-1.0, 2.0),
+        QPointF(0.3, -0.4), QPointF(2.0, 2.0), QPointF(0.9, 0.1) };
+    int numPoints = sizeof(points) / sizeof(points[0]);
+
+    for (int order = 2; order <= controls.count(); ++order) {
+        PointArray<256> curve;
+        for (int i = 0; i < order; ++i)
+            curve << controls.at(i);
+        BezierProjector<qreal> projector(order, curve.data());
+
+        /* Points of curve project onto themselves */
+        for (int i = 0; i <= 10; ++i) {
+            qreal t = i / 10.0, xy[2], dist;
+            m_fitter->point(order, curve.data(), t, xy);
+            qreal projected = projector.project(xy, &dist);
+            QVERIFY(dist < EPSILON * EPSILON);
+            QVERIFY(qAbs(projected - t) < EPSILON);
+        }
+
+        /* Nothing on curve is closer than projection */
+        PointArray<256> samples = m_fitter->curve(curve, 1000);
+        for (int i = 0; i < numPoints; ++i) {
+            const qreal *xy = reinterpret_cast<const qreal*>(&points[i]);
+            qreal dist, closest[2];
+            qreal t = projector.project(xy, &dist);
+            m_fitter->point(order, curve.data(), t, closest);
+            QVERIFY(qAbs(qSqrt(dist) - distance(QPointF(closest[0],
+                closest[1]), points[i])) < EPSILON);
+            for (int j = 0; j < samples.count(); ++j)
+                QVERIFY(distance(samples.at(j), points[i]) >=
+                    qSqrt(dist) - EPSILON);
+
+            float xyf[2] = { (float) xy[0], (float) xy[1] }, pxyf[2 * MAX_PROJECT_ORDER];
+            for (int j = 0; j < 2 * order; ++j)
+                pxyf[j] = curve[j];
+            float distf;
+            BezierProjector<float>(order, pxyf).project(xyf, &distf);
+            QVERIFY(qAbs(qSqrt(distf) - qSqrt(dist)) < 1e-3);
+        }
+    }
+
+    /* Largest distance of a batch and its point */
+    PointArray<256> curve;
+    for (int i = 0; i < SPLINE_ORDER; ++i)
+        curve << controls.at(i);
+    qreal ts[5];
+    int worst;
+    qreal maxDist = m_fitter->project(curve, StrokeView(points, numPoints),
+        ts, &worst);
+    QCOMPARE(worst, 3);
+    qreal xy[2];
+    m_fitter->point(curve.data(), ts[worst], xy);
+    QVERIFY(qAbs(maxDist - distance(QPointF(xy[0], xy[1]),
+        points[worst])) < EPSILON);
+}
+
+void CurveTest::testBatchEvaluation_data()
+{
+    QTest::addColumn<BezierEvaluator::Kernel>("kernel");
+
+    QTest::newRow("Scalar") << BezierEvaluator::SCALAR;
+    QTest::newRow("SSE2")   << BezierEvaluator::SSE2;
+    QTest::newRow("AVX2")   << BezierEvaluator::AVX2;
+}
+
+void CurveTest::testBatchEvaluation()
+{
+    QFETCH(BezierEvaluator::Kernel, kernel);
+    if (!BezierEvaluator::isSupported(kernel))
+        QSKIP("Kernel is not supported by this CPU", SkipSingle);
+
+    /* Curves of orders 2 to 6 built from the same control points */
+    PointArray<256> curve;
+    curve << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+          << QPointF(1.25, -1.0) << QPointF(1.0, 0.0)
+          << QPointF(2.0, 0.5) << QPointF(1.5, 2.0);
+
+    /* Odd count exercises remainder handling of vector kernels */
+    qreal ts[CURVE_LENGTH + 1], xy[2 * (CURVE_LENGTH + 1)];
+    float tsf[CURVE_LENGTH + 1], xyf[2 * (CURVE_LENGTH + 1)];
+    float curvef[12];
+    for (int i = 0; i <= CURVE_LENGTH; ++i) {
+        ts[i] = (qreal) i / CURVE_LENGTH;
+        tsf[i] = ts[i];
+    }
+    for (int i = 0; i < 2 * curve.count(); ++i)
+        curvef[i] = curve.data()[i];
+
+    for (int order = 2; order <= curve.count(); ++order) {
+        BezierEvaluator::evaluate(order, curve.data(), CURVE_LENGTH + 1, ts,
+            xy, kernel);
+        BezierEvaluator::evaluate(order, curvef, CURVE_LENGTH + 1, tsf,
+            xyf, kernel);
+        for (int i = 0; i <= CURVE_LENGTH; ++i) {
+            qreal expected[2];
+            m_fitter->point(order, curve.data(), ts[i], expected);
+            QVERIFY(qAbs(xy[2 * i] - expected[0]) < EPSILON);
+            QVERIFY(qAbs(xy[2 * i + 1] - expected[1]) < EPSILON);
+            /* Single precision stays well within EPSILON too */
+            QVERIFY(qAbs(xyf[2 * i] - expected[0]) < EPSILON);
+            QVERIFY(qAbs(xyf[2 * i + 1] - expected[1]) < EPSILON);
+        }
+    }
+
+    /* Two quadratic curves from one basis computation */
+    qreal cx[6], cy[6], xy2[4 * (CURVE_LENGTH + 1)];
+    float cxf[6], cyf[6], xy2f[4 * (CURVE_LENGTH + 1)];
+    BezierEvaluator::powerBasis(3, 2, curve.data(), cx, cy);
+    BezierEvaluator::powerBasis(3, 2, curvef, cxf, cyf);
+    BezierEvaluator::evaluateBasis(3, 2, cx, cy, CURVE_LENGTH + 1, ts, xy2,
+        kernel);
+    BezierEvaluator::evaluateBasis(3, 2, cxf, cyf, CURVE_LENGTH + 1, tsf,
+        xy2f, kernel);
+    for (int c = 0; c < 2; ++c) {
+        for (int i = 0; i <= CURVE_LENGTH; ++i) {
+            qreal expected[2];
+            m_fitter->point(3, curve.data() + 6 * c, ts[i], expected);
+            int j = 2 * (c * (CURVE_LENGTH + 1) + i);
+            QVERIFY(qAbs(xy2[j] - expected[0]) < EPSILON);
+            QVERIFY(qAbs(xy2[j + 1] - expected[1]) < EPSILON);
+            QVERIFY(qAbs(xy2f[j] - expected[0]) < EPSILON);
+            QVERIFY(qAbs(xy2f[j + 1] - expected[1]) < EPSILON);
+        }
+    }
+}
+
+void CurveTest::testSampling()
+{
+    PointArray<256> controls;
+    controls << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+             << QPointF(1.25, -1.0) << QPointF(1.0, 0.0)
+             << QPointF(2.0, 0.5) << QPointF(1.5, 2.0);
+    int counts[] = { 2, 3, CURVE_LENGTH, 1000 };
+
+    for (int order = 2; order <= controls.count(); ++order) {
+        PointArray<256> curve;
+        for (int i = 0; i < order; ++i)
+            curve << controls.at(i);
+        qreal bound = BezierEvaluator::sampleErrorBound(order, curve.data());
+        QVERIFY(bound < EPSILON);
+
+        for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+            PointArray<256> points = m_fitter->curve(curve, counts[c]);
+            QCOMPARE(points.count(), counts[c]);
+            QCOMPARE(points.first(), curve.first());
+            QCOMPARE(points.last(), curve.last());
+            for (int i = 0; i < points.count(); ++i) {
+                qreal expected[2];
+                m_fitter->point(order, curve.data(),
+                    (qreal) i / (counts[c] - 1), expected);
+                QVERIFY(qAbs(points.at(i).x() - expected[0]) <= bound);
+                QVERIFY(qAbs(points.at(i).y() - expected[1]) <= bound);
+            }
+        }
+    }
+}
+
+/* Fits strokes with a fitter created on worker thread on purpose */
+struct StrokeFit
+{
+    typedef PointArray<256> result_type;
+
+    StrokeFit(CurveFitter::Solver solver, CurveFitter::Precision precision)
+        : solver(solver), precision(precision) {}
+
+    PointArray<256> operator()(const PointArray<256> &points) const {
+        CurveFitter fitter;
+        fitter.setPrecision(precision);
+        PointArray<256> curve;
+        fitter.fit(points, curve, CurveFitter::AFFINE, solver);
+        return curve;
+    }
+
+    CurveFitter::Solver solver;
+    CurveFitter::Precision precision;
+};
+
+void CurveTest::testConcurrentFit_data()
+{
+    QTest::addColumn<CurveFitter::Solver>("solver");
+    QTest::addColumn<CurveFitter::Precision>("precision");
+
+    QTest::newRow("numeric") << CurveFitter::NUMERIC_LM
+        << CurveFitter::DOUBLE;
+    QTest::newRow("analytic") << CurveFitter::ANALYTIC_LM
+        << CurveFitter::DOUBLE;
+    QTest::newRow("linear") << CurveFitter::LINEAR_LS << CurveFitter::DOUBLE;
+    QTest::newRow("numeric single") << CurveFitter::NUMERIC_LM
+        << CurveFitter::SINGLE;
+    QTest::newRow("analytic single") << CurveFitter::ANALYTIC_LM
+        << CurveFitter::SINGLE;
+    QTest::newRow("linear single") << CurveFitter::LINEAR_LS
+        << CurveFitter::SINGLE;
+}
+
+void CurveTest::testConcurrentFit()
+{
+    QFETCH(CurveFitter::Solver, solver);
+    QFETCH(CurveFitter::Precision, precision);
+
+    /* Strokes sampled from differently shaped curves */
+    QList<PointArray<256> > strokes;
+    for (int i = 0; i < 64; ++i) {
+        PointArray<256> curve;
+        curve << QPointF(0.0, 0.0) << QPointF(-0.25 + 0.01 * i, 1.0)
+              << QPointF(1.25, -1.0 + 0.02 * i) << QPointF(1.0, 0.0);
+        strokes << m_fitter->curve(curve, CURVE_LENGTH);
+    }
+
+    StrokeFit fitStroke(solver, precision);
+    QList<PointArray<256> > curves =
+        QtConcurrent::blockingMapped(strokes, fitStroke);
+
+    /* Same through worker fitters of BatchFitter */
+    BatchFitter batch(4);
+    batch.setSolver(solver);
+    batch.setPrecision(precision);
+    QVector<BatchFitter::Result> results = batch.fit(strokes.toVector());
+
+    /* Results must be identical to sequential ones */
+    QCOMPARE(curves.count(), strokes.count());
+    QCOMPARE(results.count(), strokes.count());
+    for (int i = 0; i < strokes.count(); ++i) {
+        PointArray<256> expected = fitStroke(strokes.at(i));
+        QCOMPARE(curves.at(i).count(), expected.count());
+        QCOMPARE(results.at(i).curve.count(), expected.count());
+        for (int j = 0; j < expected.count(); ++j) {
+            QCOMPARE(curves.at(i).at(j), expected.at(j));
+            QCOMPARE(results.at(i).curve.at(j), expected.at(j));
+        }
+    }
+}
+
+void CurveTest::testBatchFit()
+{
+    QVector<PointArray<256> > strokes;
+    for (int i = 0; i < 100; ++i) {
+        PointArray<256> curve;
+        curve << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0 + 0.01 * i)
+              << QPointF(1.25, -1.0) << QPointF(1.0 + 0.01 * i, 0.0);
+        strokes << m_fitter->curve(curve, CURVE_LENGTH);
+    }
+    /* Stroke too short to define the curve */
+    PointArray<256> tooShort;
+    tooShort << QPointF(0.0, 0.0) << QPointF(1.0, 1.0);
+    strokes[50] = tooShort;
+
+    BatchFitter batch(4);
+    batch.setTransformation(CurveFitter::EUCLIDEAN);
+    FitStats total;
+    QVector<BatchFitter::Result> results = batch.fit(strokes, &total);
+    QCOMPARE(results.count(), strokes.count());
+    /* Short stroke is not fitted and does not count */
+    QCOMPARE(total.fits, strokes.count() - 1);
+    QVERIFY(total.maxError < EPSILON);
+    QVERIFY(total.outerIterations >= total.fits);
+    for (int i = 0; i < strokes.count(); ++i) {
+        if (i == 50) {
+            QCOMPARE(results.at(i).status, BatchFitter::TOO_FEW_POINTS);
+            continue;
+        }
+        /* Results come back in input order */
+        QCOMPARE(results.at(i).status, BatchFitter::SUCCESS);
+        QVERIFY(results.at(i).error < EPSILON);
+        QCOMPARE(results.at(i).curve.first(), strokes.at(i).first());
+        QCOMPARE(results.at(i).curve.last(), strokes.at(i).last());
+    }
+
+    /* Higher order needs more points than the default cubic */
+    batch.setOrder(SPLINE_ORDER + 1);
+    strokes[50] = m_fitter->curve(strokes.at(49), SPLINE_ORDER);
+    results = batch.fit(strokes);
+    QCOMPARE(results.at(50).status, BatchFitter::TOO_FEW_POINTS);
+    QCOMPARE(results.at(49).status, BatchFitter::SUCCESS);
+    QCOMPARE(results.at(49).curve.count(), SPLINE_ORDER + 1);
+}
+
+void CurveTest::testRefit()
+{
+    PointArray<256> curve;
+    curve << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+          << QPointF(1.25, -1.0) << QPointF(1.0, 0.0);
+    PointArray<256> points = m_fitter->curve(curve, CURVE_LENGTH);
+
+    /* Stroke grows point by point, as while it is drawn */
+    PointArray<256> stroke, curve2;
+    QVarLengthArray<qreal,256> ts;
+    for (int i = 0; i < points.count(); ++i) {
+        stroke << points.at(i);
+        if (stroke.count() < SPLINE_ORDER)
+            continue;
+
+        qreal err = m_fitter->refit(stroke, curve2, ts, CurveFitter::EUCLIDEAN);
+        QVERIFY(err < EPSILON);
+        QCOMPARE(ts.count(), stroke.count());
+        QCOMPARE(curve2.first(), stroke.first());
+        QCOMPARE(curve2.last(), stroke.last());
+    }
+
+    /* Whole curve is recovered */
+    for (int i = 0; i < curve.count(); ++i) {
+        QPointF diff = curve.at(i) - curve2.at(i);
+        QVERIFY(qAbs(diff.x()) < EPSILON && qAbs(diff.y()) < EPSILON);
+    }
+
+    /* Shrinking stroke reuses parameters of remaining points */
+    stroke.resize(CURVE_LENGTH / 2);
+    qreal err = m_fitter->refit(stroke, curve2, ts, CurveFitter::EUCLIDEAN);
+    QVERIFY(err < EPSILON);
+    QCOMPARE(ts.count(), stroke.count());
+
+    /* Max error is the distance of the farthest point from the curve at
+     * its parameter, mean squared residual is at most its square */
+    stroke[CURVE_LENGTH / 4] += 0.1;
+    QList<CurveFitter::Transformation> transformations;
+    transformations << CurveFitter::EUCLIDEAN << CurveFitter::AFFINE;
+    foreach (CurveFitter::Transformation transformation, transformations) {
+        FitStats stats;
+        err = m_fitter->refit(stroke, curve2, ts, transformation,
+            CurveFitter::ANALYTIC_LM, &stats);
+        QVector<qreal> xy(2 * ts.count());
+        BezierEvaluator::evaluate(SPLINE_ORDER, curve2.data(), ts.count(),
+            ts.data(), xy.data());
+        qreal maxError = 0;
+        for (int i = 0; i < ts.count(); ++i) {
+            QPointF diff = stroke.at(i) - QPointF(xy[2 * i], xy[2 * i + 1]);
+            maxError = qMax(maxError,
+                qSqrt(diff.x() * diff.x() + diff.y() * diff.y()));
+        }
+        QVERIFY(qAbs(stats.maxError - maxError) < 1e-9);
+        QVERIFY(maxError > EPSILON);
+        QVERIFY(transformation == CurveFitter::AFFINE ||
+            2 * err <= maxError * maxError);
+    }
+}
+
+void CurveTest::testFitOptions()
+{
+    PointArray<256> curve;
+    curve << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+          << QPointF(1.25, -1.0) << QPointF(1.0, 0.0);
+    PointArray<256> points = m_fitter->curve(curve, CURVE_LENGTH);
+
+    /* Without caps fit runs to convergence */
+    CurveFitter fitter;
+    PointArray<256> full, capped, timed;
+    FitStats stats;
+    FitOptions options;
+    options.maxRounds = 0;
+    fitter.setOptions(options);
+    qreal err = fitter.fit(points, full, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS, &stats);
+    QVERIFY(err < EPSILON);
+    QCOMPARE(stats.truncated, 0);
+    QVERIFY(stats.outerIterations > 1);
+
+    /* Noise-free points keep improving down to rounding errors, default
+     * cap on rounds stops that well after the curve is found */
+    options = FitOptions();
+    QVERIFY(options.maxRounds > 0);
+    fitter.setOptions(options);
+    qreal defaultErr = fitter.fit(points, capped, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS, &stats);
+    QVERIFY(defaultErr < EPSILON);
+    QVERIFY(stats.outerIterations <= options.maxRounds);
+
+    /* Single round is what a one round budget buys */
+    options.maxRounds = 1;
+    fitter.setOptions(options);
+    qreal cappedErr = fitter.fit(points, capped, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS, &stats);
+    QCOMPARE(stats.truncated, 1);
+    QCOMPARE(stats.outerIterations, 1);
+    QVERIFY(cappedErr >= err);
+    QCOMPARE(capped.count(), SPLINE_ORDER);
+
+    /* Exhausted time budget still gives curve of the first round */
+    options = FitOptions();
+    options.timeBudget = 1;
+    fitter.setOptions(options);
+    qreal timedErr = fitter.fit(points, timed, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS, &stats);
+    QCOMPARE(stats.truncated, 1);
+    QCOMPARE(stats.outerIterations, 1);
+    QCOMPARE(timedErr, cappedErr);
+    for (int i = 0; i < SPLINE_ORDER; ++i)
+        QCOMPARE(timed.at(i), capped.at(i));
+
+    /* Newton steps that cannot settle in a single step fall back to
+     * projection and the fit still converges */
+    options = FitOptions();
+    options.maxNewtonIterations = 1;
+    fitter.setOptions(options);
+    qreal newtonErr = fitter.fit(points, capped, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS, &stats);
+    QVERIFY(newtonErr < EPSILON);
+
+    /* Exact fit has zero error in consecutive rounds, which ends it even
+     * without a cap on rounds */
+    PointArray<256> exact;
+    exact << QPointF(0.0, 0.0) << QPointF(1.0, 2.0)
+          << QPointF(2.0, 1.0) << QPointF(3.0, 3.0);
+    options = FitOptions();
+    options.maxRounds = 0;
+    fitter.setOptions(options);
+    qreal exactErr = fitter.fit(exact, full, CurveFitter::EUCLIDEAN,
+        CurveFitter::ANALYTIC_LM, &stats);
+    QVERIFY(exactErr < EPSILON);
+    QCOMPARE(stats.truncated, 0);
+}
+
+void CurveTest::testFitWorkspace()
+{
+    FitWorkspace workspace;
+    workspace.reset(FitWorkspace::size<float>(3) +
+        FitWorkspace::size<qreal>(5));
+    float *a = workspace.allocate<float>(3);
+    qreal *b = workspace.allocate<qreal>(5);
+    QCOMPARE((quintptr) a % WORKSPACE_ALIGN, (quintptr) 0);
+    QCOMPARE((quintptr) b % WORKSPACE_ALIGN, (quintptr) 0);
+    QCOMPARE(workspace.allocations(), 1);
+    /* Smaller requests reuse memory */
+    workspace.reset(FitWorkspace::size<qreal>(5));
+    QCOMPARE(workspace.allocate<qreal>(5), (qreal*) a);
+    QCOMPARE(workspace.allocations(), 1);
+
+    /* Strokes of sizes seen before fit without growing workspace and
+     * give the same curves as a fresh fitter */
+    CurveFitter fitter;
+    QList<PointArray<256> > strokes;
+    for (int i = 0; i < 8; ++i) {
+        PointArray<256> curve;
+        curve << QPointF(0.0, 0.0) << QPointF(-0.25 + 0.05 * i, 1.0)
+              << QPointF(1.25, -1.0) << QPointF(1.0, 0.0);
+        strokes << m_fitter->curve(curve, CURVE_LENGTH + 20 * (i % 4));
+    }
+    PointArray<256> curve;
+    for (int i = 0; i < strokes.count(); ++i)
+        fitter.fit(strokes.at(i), curve, CurveFitter::AFFINE,
+            CurveFitter::LINEAR_LS);
+    int allocations = fitter.workspace().allocations();
+    for (int i = strokes.count() - 1; i >= 0; --i) {
+        fitter.fit(strokes.at(i), curve, CurveFitter::AFFINE,
+            CurveFitter::ANALYTIC_LM);
+        CurveFitter fresh;
+        PointArray<256> expected;
+        fresh.fit(strokes.at(i), expected, CurveFitter::AFFINE,
+            CurveFitter::ANALYTIC_LM);
+        for (int j = 0; j < SPLINE_ORDER; ++j)
+            QCOMPARE(curve.at(j), expected.at(j));
+    }
+    QCOMPARE(fitter.workspace().allocations(), allocations);
+}
+
+void CurveTest::testFitOrder()
+{
+    CurveFitter fitter;
+    QCOMPARE(fitter.order(), SPLINE_ORDER);
+
+    /* Wave, which each order up to quintic fits better */
+    PointArray<256> points;
+    for (int i = 0; i < CURVE_LENGTH; ++i) {
+        qreal t = (qreal) i / (CURVE_LENGTH - 1);
+        points << QPointF(t, 0.2 * qSin(8.0 * t));
+    }
+    qreal prevErr[2] = { 1.0, 1.0 };
+    for (int order = MIN_FIT_ORDER; order <= MAX_FIT_ORDER; ++order) {
+        fitter.setOrder(order);
+        for (int single = 0; single < 2; ++single) {
+            fitter.setPrecision(single ? CurveFitter::SINGLE :
+                CurveFitter::DOUBLE);
+            PointArray<256> fitted;
+            qreal err = fitter.fit(points, fitted, CurveFitter::AFFINE,
+                single ? CurveFitter::ANALYTIC_LM : CurveFitter::LINEAR_LS);
+            QCOMPARE(fitted.count(), order);
+            QVERIFY(err < prevErr[single]);
+            prevErr[single] = err;
+        }
+    }
+    QVERIFY(prevErr[1] < EPSILON);
+
+    /* Lowest order within tolerance is chosen, order() caps it */
+    PointArray<256> fitted;
+    fitter.setPrecision(CurveFitter::DOUBLE);
+    qreal dist = fitter.fitLowestOrder(points, fitted, 0.1,
+        CurveFitter::AFFINE, CurveFitter::LINEAR_LS);
+    QCOMPARE(fitted.count(), 4);
+    QVERIFY(dist <= 0.1);
+    dist = fitter.fitLowestOrder(points, fitted, 0.01, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS);
+    QCOMPARE(fitted.count(), 5);
+    QVERIFY(dist <= 0.01);
+    fitter.setOrder(4);
+    dist = fitter.fitLowestOrder(points, fitted, 0.01, CurveFitter::AFFINE,
+        CurveFitter::LINEAR_LS);
+    QCOMPARE(fitted.count(), 4);
+    QVERIFY(dist > 0.01);
+
+    /* Samples of a parabola take a quadratic exactly */
+    PointArray<256> curve;
+    curve << QPointF(0.0, 0.0) << QPointF(0.5, 1.0) << QPointF(1.0, 0.0);
+    dist = fitter.fitLowestOrder(m_fitter->curve(curve, CURVE_LENGTH),
+        fitted, EPSILON, CurveFitter::AFFINE, CurveFitter::LINEAR_LS);
+    QCOMPARE(fitted.count(), MIN_FIT_ORDER);
+    QVERIFY(dist < EPSILON);
+}
+
+void CurveTest::testPiecewiseFit()
+{
+    /* Smooth wave, far from any single cubic */
+    PointArray<256> stroke;
+    for (int i = 0; i < 4 * CURVE_LENGTH; ++i) {
+        qreal t = (qreal) i / (4 * CURVE_LENGTH - 1);
+        stroke << QPointF(500.0 * t, 60.0 * qSin(12.0 * t));
+    }
+    qreal tolerance = 0.5;
+
+    for (int shared = 0; shared < 2; ++shared) {
+        PiecewiseFitter fitter;
+        fitter.setTolerance(tolerance);
+        fitter.setSharedTangents(shared);
+        QVarLengthArray<int,64> knots;
+        PointArray<256> spline = fitter.fit(stroke, &knots);
+
+        int pieces = PiecewiseFitter::pieceCount(spline);
+        QVERIFY(pieces > 1);
+        QCOMPARE(spline.count(), 3 * pieces + 1);
+        QCOMPARE(knots.count(), pieces + 1);
+        QCOMPARE(knots.first(), 0);
+        QCOMPARE(knots.last(), stroke.count() - 1);
+        QCOMPARE(spline.first(), stroke.first());
+        QCOMPARE(spline.last(), stroke.last());
+
+        for (int i = 0; i < pieces; ++i) {
+            /* Every point is within tolerance of its piece */
+            PointArray<256> piece = PiecewiseFitter::piece(spline, i);
+            StrokeView points = StrokeView(stroke).mid(knots[i],
+                knots[i + 1] - knots[i] + 1);
+            QCOMPARE(piece.first(), points.first());
+            QCOMPARE(piece.last(), points.last());
+            QVarLengthArray<qreal,256> ts(points.count());
+            for (int j = 0; j < points.count(); ++j)
+                ts[j] = (qreal) j / (points.count() - 1);
+            qreal error = 0;
+            for (int r = 0; r < 4; ++r)
+                error = m_fitter->project(piece, points, ts.data());
+            QVERIFY(error <= tolerance);
+
+            /* Shared tangents make joints smooth */
+            if (shared && i > 0) {
+                QPointF in = spline.at(3 * i) - spline.at(3 * i - 1);
+                QPointF out = spline.at(3 * i + 1) - spline.at(3 * i);
+                qreal cross = in.x() * out.y() - in.y() * out.x();
+                qreal dot = in.x() * out.x() + in.y() * out.y();
+                QVERIFY(qAbs(cross) < EPSILON * dot);
+            }
+        }
+    }
+}
+
+/* Zigzag of count points with occasional spikes, so that there are
+ * outliers to find */
+static PointArray<256> zigzagStroke(int count)
+{
+    PointArray<256> stroke;
+    for (int i = 0; i < count; ++i)
+        stroke << QPointF(3.0 * i + 5.0 * qSin(i * 12.9898),
+            (i % 37 == 0 ? 40.0 : 1.0) * (2.0 + 2.0 * qSin(i * 78.233)));
+    return stroke;
+}
+
+/* Two jittered curves meeting at a sharp corner at point
+ * CURVE_LENGTH - 1 */
+static PointArray<256> cornerStroke(CurveFitter &fitter)
+{
+    PointArray<256> curve1, curve2;
+    curve1 << QPointF(0.0, 0.0) << QPointF(30.0, 40.0)
+           << QPointF(70.0, 40.0) << QPointF(100.0, 0.0);
+    curve2 << QPointF(100.0, 0.0) << QPointF(120.0, 50.0)
+           << QPointF(160.0, 90.0) << QPointF(200.0, 100.0);
+    PointArray<256> points1 = fitter.curve(curve1, CURVE_LENGTH);
+    PointArray<256> points2 = fitter.curve(curve2, CURVE_LENGTH);
+
+    PointArray<256> stroke;
+    for (int i = 0; i < points1.count(); ++i)
+        stroke << points1.at(i);
+    for (int i = 1; i < points2.count(); ++i)
+        stroke << points2.at(i);
+    /* Deterministic jitter of hand drawn stroke */
+    for (int i = 0; i < 2 * stroke.count(); ++i)
+        stroke[i] += 0.05 * qSin(i * 12.9898);
+    return stroke;
+}
+
+/* Breakpoints of whole stroke from detector fed all its points */
+static QVarLengthArray<int,128> streamedBreakpoints(
+    const PointArray<256> &stroke, CornerDetector &detector)
+{
+    detector.reset();
+    for (int i = 0; i < stroke.count(); ++i)
+        detector.addPoint(stroke.at(i));
+    return detector.breakpoints(stroke);
+}
+
+void CurveTest::testCornerDetector()
+{
+    PointArray<256> stroke = cornerStroke(*m_fitter);
+
+    /* Provisional breakpoint is reported once it cannot be dropped at
+     * stroke end */
+    CornerDetector detector;
+    for (int i = 0; i < stroke.count(); ++i) {
+        int breakpoint = detector.addPoint(stroke.at(i));
+        if (breakpoint >= 0)
+            QCOMPARE(i, breakpoint + 1 + TINY_SEGMENT);
+    }
+    QVarLengthArray<int,128> provisional = detector.provisional();
+    QCOMPARE(provisional.first(), -1);
+    QCOMPARE(provisional.last(), stroke.count() - 2);
+
+    /* Statistics of whole stroke find the corner, the same as two pass
+     * detection over intermediate arrays */
+    QVarLengthArray<int,128> streamed = streamedBreakpoints(stroke, detector);
+    QVERIFY(streamed == StrokeAnalyzer::breakpoints(stroke));
+    QCOMPARE(streamed.count(), 3);
+    QVERIFY(qAbs(streamed.at(1) + 1 - (CURVE_LENGTH - 1)) <= 1);
+    PointArray<256> points1 = StrokeAnalyzer::derivative(stroke);
+    PointArray<256> points2 = StrokeAnalyzer::derivative(points1);
+    QVarLengthArray<int,128> outliers = StrokeAnalyzer::detectOutliers(
+        StrokeAnalyzer::length(points2), OUTLIER_MULTIPLIER);
+    QCOMPARE(outliers.count(), streamed.count());
+    for (int i = 1; i < outliers.count(); ++i)
+        QCOMPARE(outliers.at(i) + 2, streamed.at(i));
+
+    /* Spikes stand out of running statistics as well, provisional
+     * breakpoints are final ones */
+    PointArray<256> zigzag = zigzagStroke(300);
+    streamed = streamedBreakpoints(zigzag, detector);
+    QVERIFY(streamed == StrokeAnalyzer::breakpoints(zigzag));
+    QVERIFY(streamed.count() > 2);
+    provisional = detector.provisional();
+    QCOMPARE(provisional.count(), streamed.count());
+    for (int i = 0; i < streamed.count(); ++i)
+        QCOMPARE(provisional.at(i), streamed.at(i));
+
+    /* Stroke too short for statistics is a single segment */
+    PointArray<256> shortStroke;
+    for (int i = 0; i < 3; ++i)
+        shortStroke << stroke.at(i);
+    streamed = streamedBreakpoints(shortStroke, detector);
+    QVERIFY(streamed == StrokeAnalyzer::breakpoints(shortStroke));
+    QCOMPARE(streamed.count(), 2);
+    QCOMPARE(streamed.at(0), -1);
+    QCOMPARE(streamed.at(1), 1);
+    provisional = detector.provisional();
+    QCOMPARE(provisional.count(), 2);
+    QCOMPARE(provisional.at(1), 1);
+}
+
+void CurveTest::testIncrementalFit()
+{
+    PointArray<256> stroke = cornerStroke(*m_fitter);
+
+    /* Previews get too little time to converge */
+    IncrementalFitter fitter;
+    fitter.setPreviewBudget(1);
+    int closed = 0;
+    for (int i = 0; i < stroke.count(); ++i) {
+        closed += fitter.addPoint(stroke.at(i));
+        /* Long open segment is thinned out for previews */
+        QVERIFY(fitter.previewPoints() <= PREVIEW_POINTS);
+    }
+    QVERIFY(closed >= 1);
+    QVERIFY(!fitter.preview().isEmpty());
+    QVERIFY(fitter.previewStats().truncated > 0);
+    QVERIFY(stroke.count() - fitter.openBegin() > PREVIEW_POINTS);
+    QVERIFY(fitter.previewPoints() > SPLINE_ORDER);
+
+    /* Stroke ends on breakpoints of whole stroke, provisional corners
+     * before the real one are dropped, and on fits without budget, not
+     * on the last preview */
+    QCOMPARE(fitter.finish(), 0);
+    const QVector<IncrementalFitter::Segment> &segments = fitter.segments();
+    QVarLengthArray<int,128> breakpoints = StrokeAnalyzer::breakpoints(stroke);
+    QCOMPARE(segments.count(), 2);
+    QCOMPARE(segments.at(0).begin, 0);
+    QCOMPARE(segments.at(0).end, breakpoints.at(1) + 1);
+    QCOMPARE(segments.at(1).begin, segments.at(0).end);
+    QCOMPARE(segments.at(1).end, stroke.count() - 1);
+    foreach (const IncrementalFitter::Segment &segment, segments) {
+        QCOMPARE(segment.stats.truncated, 0);
+        QCOMPARE(segment.curve.count(), SPLINE_ORDER);
+        QCOMPARE(segment.knots.count(), 2);
+        QCOMPARE(segment.knots.last(), segment.end - segment.begin);
+        QVERIFY(segment.stats.error < 0.1);
+    }
+
+    /* Piecewise segments are the same, with composite splines whose
+     * pieces cover all their points */
+    IncrementalFitter piecewise;
+    piecewise.setPiecewise(true);
+    for (int i = 0; i < stroke.count(); ++i)
+        piecewise.addPoint(stroke.at(i));
+    piecewise.finish();
+    QCOMPARE(piecewise.segments().count(), segments.count());
+    for (int i = 0; i < segments.count(); ++i) {
+        const IncrementalFitter::Segment &segment = piecewise.segments().at(i);
+        QCOMPARE(segment.begin, segments.at(i).begin);
+        QCOMPARE(segment.end, segments.at(i).end);
+        int pieces = PiecewiseFitter::pieceCount(segment.curve);
+        QVERIFY(pieces >= 1);
+        QCOMPARE(segment.knots.count(), pieces + 1);
+        QCOMPARE(segment.knots.first(), 0);
+        QCOMPARE(segment.knots.last(), segment.end - segment.begin);
+    }
+
+    /* Segments closed at provisional corners, which are final ones, are
+     * kept, and whole stroke at once gets the same segments */
+    PointArray<256> zigzag = zigzagStroke(300);
+    fitter.reset();
+    closed = 0;
+    for (int i = 0; i < zigzag.count(); ++i)
+        closed += fitter.addPoint(zigzag.at(i));
+    QVERIFY(closed > 0);
+    QCOMPARE(fitter.finish(), closed);
+    IncrementalFitter whole;
+    whole.fit(zigzag);
+    breakpoints = StrokeAnalyzer::breakpoints(zigzag);
+    QCOMPARE(whole.segments().count(), breakpoints.count() - 1);
+    QCOMPARE(fitter.segments().count(), whole.segments().count());
+    for (int i = 0; i < whole.segments().count(); ++i) {
+        QCOMPARE(whole.segments().at(i).end, breakpoints.at(i + 1) + 1);
+        QCOMPARE(fitter.segments().at(i).end, whole.segments().at(i).end);
+    }
+
+    /* Budget of final fits stops them after the first round */
+    fitter.setCloseBudget(1);
+    fitter.fit(zigzag);
+    foreach (const IncrementalFitter::Segment &segment, fitter.segments()) {
+        QCOMPARE(segment.stats.truncated, 1);
+        QCOMPARE(segment.curve.count(), SPLINE_ORDER);
+    }
+
+    /* Corners closer than SPLINE_ORDER points close segments too short
+     * for a curve instead of being merged into the next segment */
+    IncrementalFitter dense(0);
+    closed = 0;
+    for (int i = 0; i < stroke.count(); ++i)
+        closed += dense.addPoint(stroke.at(i));
+    QCOMPARE(dense.segments().count(), closed);
+    int shortSegments = 0;
+    int begin = 0;
+    foreach (const IncrementalFitter::Segment &segment, dense.segments()) {
+        QCOMPARE(segment.begin, begin);
+        begin = segment.end;
+        if (segment.end - segment.begin + 1 < SPLINE_ORDER) {
+            QVERIFY(segment.curve.isEmpty());
+            QVERIFY(segment.knots.isEmpty());
+            shortSegments++;
+        }
+    }
+    QVERIFY(shortSegments > 0);
+    dense.finish();
+    breakpoints = StrokeAnalyzer::breakpoints(stroke, OUTLIER_MULTIPLIER, 0);
+    QCOMPARE(dense.segments().count(), breakpoints.count() - 1);
+    for (int i = 0; i < dense.segments().count(); ++i)
+        QCOMPARE(dense.segments().at(i).end, breakpoints.at(i + 1) + 1);
+}
+
+void CurveTest::testOutliers()
+{
+    PointArray<256> stroke = zigzagStroke(300);
+
+    /* Fused kernel matches chain of intermediate arrays */
+    PointArray<256> points1 = StrokeAnalyzer::derivative(stroke);
+    PointArray<256> points2 = StrokeAnalyzer::derivative(points1);
+    QVarLengthArray<int,128> expected = StrokeAnalyzer::detectOutliers(
+        StrokeAnalyzer::length(points2), OUTLIER_MULTIPLIER);
+    QVarLengthArray<int,128> fused =
+        StrokeAnalyzer::outliers(stroke, OUTLIER_MULTIPLIER);
+    QVERIFY(expected.count() > 2);
+    QCOMPARE(fused.count(), expected.count());
+    for (int i = 0; i < expected.count(); ++i)
+        QCOMPARE(fused.at(i), expected.at(i));
+}
+
+void CurveTest::testPointArraySoA()
+{
+    PointArray<256> curve;
+    curve << QPointF(0.0, 0.0) << QPointF(-0.25, 1.0)
+          << QPointF(1.25, -1.0) << QPointF(1.0, 0.0);
+
+    /* Same samples in either layout, conversions are lossless */
+    PointArray<256> points = m_fitter->curve(curve, CURVE_LENGTH);
+    PointArraySoA<256> soa;
+    m_fitter->curve(curve, CURVE_LENGTH, soa);
+    QCOMPARE(soa.count(), points.count());
+    for (int i = 0; i < points.count(); ++i)
+        QCOMPARE(soa.at(i), points.at(i));
+    QVERIFY(PointArraySoA<256>(points).toPointArray() == points);
+
+    /* Same fits in either layout */
+    PointArray<256> curve1, curve2;
+    qreal err1 = m_fitter->fit(points, curve1, CurveFitter::AFFINE);
+    qreal err2 = m_fitter->fit(soa, curve2, CurveFitter::AFFINE);
+    QCOMPARE(err2, err1);
+    QVERIFY(curve2 == curve1);
+
+    /* Same segmentation in either layout */
+    PointArray<256> stroke = zigzagStroke(300);
+    PointArraySoA<256> strokeSoA(stroke);
+    QVarLengthArray<int,128> expected = StrokeAnalyzer::breakpoints(stroke);
+    QVarLengthArray<int,128> breakpoints =
+        StrokeAnalyzer::breakpoints(strokeSoA);
+    QVERIFY(breakpoints == expected);
+
+    QVector<PointArray<256> > segments =
+        StrokeAnalyzer::segments(stroke, expected);
+    QVector<PointArraySoA<256> > segmentsSoA =
+        StrokeAnalyzer::segments(strokeSoA, breakpoints);
+    QCOMPARE(segmentsSoA.count(), segments.count());
+    for (int i = 0; i < segments.count(); ++i)
+        QVERIFY(segmentsSoA.at(i).toPointArray() == segments.at(i));
+}
+
+void CurveTest::testStrokeView()
+{
+    PointArray<256> stroke = zigzagStroke(300);
+
+    /* External buffers, points with pressure make stride 3 */
+    QVector<QPointF> vector;
+    QVector<qreal> pressured;
+    for (int i = 0; i < stroke.count(); ++i) {
+        vector << stroke.at(i);
+        pressured << stroke.at(i).x() << stroke.at(i).y() << 0.5;
+    }
+    StrokeView vectorView(vector.constData(), vector.count());
+    StrokeView pressuredView(pressured.constData(),
+        pressured.constData() + 1, stroke.count(), 3);
+    QCOMPARE(vectorView.count(), stroke.count());
+    QCOMPARE(pressuredView.at(7), stroke.at(7));
+
+    /* Same segmentation of any layout */
+    QVarLengthArray<int,128> expected = StrokeAnalyzer::breakpoints(stroke);
+    QVERIFY(StrokeAnalyzer::breakpoints(vectorView) == expected);
+    QVERIFY(StrokeAnalyzer::breakpoints(pressuredView) == expected);
+
+    /* Segment views point into stroke */
+    QVector<PointArray<256> > segments =
+        StrokeAnalyzer::segments(stroke, expected);
+    QVector<StrokeView> views =
+        StrokeAnalyzer::segmentViews(pressuredView, expected);
+    QCOMPARE(views.count(), segments.count());
+    for (int i = 0; i < segments.count(); ++i) {
+        QCOMPARE(views.at(i).count(), segments.at(i).count());
+        for (int j = 0; j < segments.at(i).count(); ++j)
+            QCOMPARE(views.at(i).at(j), segments.at(i).at(j));
+    }
+
+    /* Same fit of a copy and of a view */
+    PointArray<256> curve1, curve2;
+    qreal err1 = m_fitter->fit(segments.at(1), curve1, CurveFitter::AFFINE);
+    qreal err2 = m_fitter->fit(views.at(1), curve2, CurveFitter::AFFINE);
+    QCOMPARE(err2, err1);
+    QVERIFY(curve2 == curve1);
+}
+
 void CurveTest::cleanupTestCase()
 {
     qDebug("Test case cleanup");
@@ -40,7 +40,25 @@ private slots:
     void testCurve();
     void testSplit();
     void testGoldenSectionSearch();
+    void testMinimizer();
     void testReparametrization();
+    void testProjection();
+    void testBatchEvaluation_data();
+    void testBatchEvaluation();
+    void testSampling();
+    void testConcurrentFit_data();
+    void testConcurrentFit();
+    void testBatchFit();
+    void testRefit();
+    void testFitOptions();
+    void testFitWorkspace();
+    void testFitOrder();
+    void testPiecewiseFit();
+    void testCornerDetector();
+    void testIncrementalFit();
+    void testOutliers();
+    void testPointArraySoA();
+    void testStrokeView();
     void cleanupTestCase();
 
 public:
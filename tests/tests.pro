@@ -1,19 +1,12 @@
 TEMPLATE = app
 TARGET = curvetest
-CONFIG   += console
+CONFIG   += console c++14
 
 QT += testlib
 QT -= gui
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
 
-LIBS += -lm -llevmar
-
-INCLUDEPATH = ../src
-
-HEADERS += ../src/curvefitter.h
-SOURCES += ../src/curvefitter.cpp
-HEADERS += ../src/pointerarray.h
-HEADERS += ../src/utils.h
-SOURCES += ../src/utils.cpp
+include(../lib/curvescore.pri)
 
 HEADERS += curvetest.h
 SOURCES += curvetest.cpp